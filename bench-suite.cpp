@@ -0,0 +1,537 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "robots.h"
+
+/**
+ * A benchmark suite over a synthetic corpus of robots.txt files, from the RFC's example
+ * up to files of half a megabyte, reporting machine-readable results:
+ *
+ *     ./bench-suite [--json] [--quick] [--dump <directory>]
+ *
+ * Results are CSV unless --json is given. --quick runs fewer iterations, for a smoke
+ * test, and --dump writes each generated robots.txt into the directory. The corpus is
+ * generated from a fixed seed, so that runs are comparable.
+ *
+ * When built with REP_COUNT_ALLOCATIONS defined (as bench-allocs is), operator new is
+ * replaced to count allocations, and the allocations per parse and per check, and the
+ * bytes actually held by each parsed object, are reported too.
+ */
+
+#ifdef REP_COUNT_ALLOCATIONS
+
+// The number of allocations made, and the bytes currently allocated, through
+// operator new
+std::atomic<size_t> allocations(0);
+std::atomic<size_t> live_bytes(0);
+
+namespace
+{
+    // Room for the size of each allocation, without breaking its alignment
+    const size_t header = alignof(std::max_align_t);
+}
+
+// These are kept out of line, since once inlined the compiler would see the header
+// being read outside of the object that was allocated
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    char* block = static_cast<char*>(std::malloc(size + header));
+    if (!block)
+    {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = size;
+    ++allocations;
+    live_bytes += size;
+    return block + header;
+}
+
+__attribute__((noinline)) void operator delete(void* pointer) noexcept
+{
+    if (pointer)
+    {
+        char* block = static_cast<char*>(pointer) - header;
+        live_bytes -= *reinterpret_cast<size_t*>(block);
+        std::free(block);
+    }
+}
+
+#endif
+
+namespace
+{
+    typedef std::chrono::steady_clock clock_type;
+
+    /**
+     * One robots.txt in the corpus, with the agent and paths to check against it.
+     */
+    struct Case
+    {
+        std::string name;
+        std::string content;
+        std::string agent;
+        std::vector<std::string> paths;
+    };
+
+    /**
+     * The measurements for one case. Latencies are in nanoseconds.
+     */
+    struct Result
+    {
+        std::string name;
+        size_t bytes;
+        size_t parses;
+        double parse_mb_per_s;
+        double parse_docs_per_s;
+        double parse_ns_p50;
+        double parse_ns_p99;
+        size_t memory_bytes;
+        size_t checks;
+        double checks_per_s;
+        double check_ns_p50;
+        double check_ns_p99;
+#ifdef REP_COUNT_ALLOCATIONS
+        double allocations_per_parse;
+        double allocations_per_check;
+        size_t heap_bytes;
+#endif
+    };
+
+    /**
+     * Generates robots.txt files that resemble those seen in the wild.
+     */
+    class Generator
+    {
+    public:
+        explicit Generator(unsigned seed) : random_(seed) {}
+
+        /**
+         * A random integer in [low, high].
+         */
+        size_t between(size_t low, size_t high)
+        {
+            return std::uniform_int_distribution<size_t>(low, high)(random_);
+        }
+
+        /**
+         * Whether an event with the given probability happens.
+         */
+        bool chance(double probability)
+        {
+            return std::uniform_real_distribution<double>(0, 1)(random_) < probability;
+        }
+
+        /**
+         * A lowercase word, as found in path segments and agent names.
+         */
+        std::string word()
+        {
+            std::string result;
+            for (size_t index = between(3, 10); index > 0; --index)
+            {
+                result.push_back('a' + between(0, 25));
+            }
+            return result;
+        }
+
+        /**
+         * A path of a few segments, possibly with a file name or a query.
+         */
+        std::string path()
+        {
+            std::string result;
+            for (size_t index = between(1, 4); index > 0; --index)
+            {
+                result += "/" + word();
+            }
+            if (chance(0.3))
+            {
+                result += "/" + word() + ".html";
+            }
+            else if (chance(0.2))
+            {
+                result += "?" + word() + "=" + std::to_string(between(0, 1000));
+            }
+            else
+            {
+                result += "/";
+            }
+            return result;
+        }
+
+        /**
+         * A rule with up to wildcards '*' in it, and perhaps an ending '$'.
+         */
+        std::string rule(size_t wildcards)
+        {
+            std::string result(path());
+            for (size_t index = between(0, wildcards); index > 0; --index)
+            {
+                result.insert(between(1, result.size()), "*");
+            }
+            if (wildcards && chance(0.3))
+            {
+                result += "$";
+            }
+            return result;
+        }
+
+        /**
+         * A group of names sharing count rules, a fraction of which have wildcards.
+         */
+        std::string group(const std::vector<std::string>& names, size_t count,
+                          double wildcard)
+        {
+            std::string result;
+            for (const auto& name : names)
+            {
+                result += "User-agent: " + name + "\n";
+            }
+            if (chance(0.2))
+            {
+                result += "Crawl-delay: " + std::to_string(between(1, 10)) + "\n";
+            }
+            for (size_t index = 0; index < count; ++index)
+            {
+                result += chance(0.3) ? "Allow: " : "Disallow: ";
+                result += rule(chance(wildcard) ? 3 : 0) + "\n";
+            }
+            return result + "\n";
+        }
+
+        /**
+         * Paths to check against content: half are extensions of its rules, so that
+         * they are likely to match, and half are random.
+         */
+        std::vector<std::string> paths(const std::string& content, size_t count)
+        {
+            std::vector<std::string> rules;
+            size_t start = 0;
+            while ((start = content.find("llow: /", start)) != std::string::npos)
+            {
+                start += 6;
+                size_t end = content.find_first_of("*$\n", start);
+                rules.push_back(content.substr(start, end - start));
+            }
+
+            std::vector<std::string> result;
+            for (size_t index = 0; index < count; ++index)
+            {
+                if (!rules.empty() && index % 2 == 0)
+                {
+                    result.push_back(rules[between(0, rules.size() - 1)] + word());
+                }
+                else
+                {
+                    result.push_back(path());
+                }
+            }
+            return result;
+        }
+
+    private:
+        std::mt19937 random_;
+    };
+
+    std::vector<Case> corpus()
+    {
+        Generator generator(20161017);
+        std::vector<Case> cases;
+        const size_t paths = 1000;
+
+        Case small;
+        small.name = "small";
+        small.content =
+            "# /robots.txt for http://www.fict.org/\n"
+            "# comments to webmaster@fict.org\n"
+            "\n"
+            "User-agent: unhipbot\n"
+            "Disallow: /\n"
+            "\n"
+            "User-agent: webcrawler\n"
+            "User-agent: excite\n"
+            "Disallow:\n"
+            "\n"
+            "User-agent: *\n"
+            "Disallow: /org/plans.html\n"
+            "Allow: /org/\n"
+            "Allow: /serv\n"
+            "Allow: /~mak\n"
+            "Disallow: /\n";
+        small.agent = "my-agent";
+        small.paths = generator.paths(small.content, paths);
+        cases.push_back(small);
+
+        Case medium;
+        medium.name = "medium";
+        for (size_t index = 0; index < 4; ++index)
+        {
+            medium.content += generator.group({generator.word() + "bot"}, 40, 0.1);
+        }
+        medium.content += generator.group({"*"}, 40, 0.1);
+        medium.content += "Sitemap: http://example.com/sitemap.xml\n";
+        medium.agent = "my-agent";
+        medium.paths = generator.paths(medium.content, paths);
+        cases.push_back(medium);
+
+        // Several large groups, one of which is checked
+        Case large;
+        large.name = "large-500k";
+        large.agent = "my-agent";
+        while (large.content.size() < (500 << 10))
+        {
+            std::string name = large.content.empty() ? large.agent : generator.word();
+            large.content += generator.group({name}, 500, 0.1);
+        }
+        large.paths = generator.paths(large.content, paths);
+        cases.push_back(large);
+
+        // Thousands of small groups, some sharing their rules between names
+        Case agents;
+        agents.name = "many-agents";
+        for (size_t index = 0; index < 5000; ++index)
+        {
+            std::vector<std::string> names;
+            for (size_t name = generator.between(1, 3); name > 0; --name)
+            {
+                names.push_back(generator.word() + "-" + std::to_string(index));
+            }
+            if (index == 2500)
+            {
+                agents.agent = names.front();
+            }
+            agents.content += generator.group(names, generator.between(1, 4), 0.2);
+        }
+        agents.paths = generator.paths(agents.content, paths);
+        cases.push_back(agents);
+
+        Case wildcards;
+        wildcards.name = "wildcard-heavy";
+        wildcards.content = generator.group({"*"}, 2000, 1.0);
+        wildcards.agent = "my-agent";
+        wildcards.paths = generator.paths(wildcards.content, paths);
+        cases.push_back(wildcards);
+
+        // Rules that could match at every position, without ever matching
+        Case pathological;
+        pathological.name = "pathological";
+        pathological.content = "User-agent: *\n";
+        for (size_t index = 1; index <= 200; ++index)
+        {
+            std::string rule("/");
+            for (size_t star = 0; star < 2 + index % 8; ++star)
+            {
+                rule += "*a";
+            }
+            pathological.content += "Disallow: " + rule + "*b" +
+                std::to_string(index) + "\n";
+        }
+        pathological.agent = "my-agent";
+        for (size_t index = 0; index < paths / 10; ++index)
+        {
+            pathological.paths.push_back("/" + std::string(500 + index, 'a'));
+        }
+        cases.push_back(pathological);
+
+        return cases;
+    }
+
+    /**
+     * The value at the given fraction of the sorted samples.
+     */
+    double percentile(std::vector<double>& samples, double fraction)
+    {
+        std::sort(samples.begin(), samples.end());
+        size_t index = static_cast<size_t>(fraction * (samples.size() - 1) + 0.5);
+        return samples[index];
+    }
+
+    double elapsed(clock_type::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+    }
+
+    Result measure(const Case& test, double budget)
+    {
+        Result result;
+        result.name = test.name;
+        result.bytes = test.content.size();
+
+        // Parse until the time budget is spent, timing each parse
+        std::vector<double> parses;
+        double total = 0;
+        while (parses.size() < 3 || total < budget)
+        {
+            auto start = clock_type::now();
+            Rep::Robots robots(test.content);
+            parses.push_back(elapsed(start));
+            total += parses.back();
+        }
+        result.parses = parses.size();
+        result.parse_docs_per_s = parses.size() / (total / 1e9);
+        result.parse_mb_per_s = result.parse_docs_per_s * result.bytes / 1e6;
+        result.parse_ns_p50 = percentile(parses, 0.5);
+        result.parse_ns_p99 = percentile(parses, 0.99);
+
+#ifdef REP_COUNT_ALLOCATIONS
+        size_t before = live_bytes;
+        size_t count = allocations;
+#endif
+        std::unique_ptr<Rep::Robots> robots(new Rep::Robots(test.content));
+        result.memory_bytes = robots->memory_usage();
+#ifdef REP_COUNT_ALLOCATIONS
+        result.heap_bytes = live_bytes - before;
+        result.allocations_per_parse = allocations - count;
+#endif
+
+        // Check every path in rounds until the time budget is spent
+        Rep::Robots::AgentRef agent = robots->resolve(test.agent);
+        size_t allowed = 0;
+#ifdef REP_COUNT_ALLOCATIONS
+        // Counted over one untimed round, apart from recording the samples
+        count = allocations;
+        for (const auto& path : test.paths)
+        {
+            allowed += robots->allowed(path, agent);
+        }
+        result.allocations_per_check = static_cast<double>(allocations - count) /
+            test.paths.size();
+#endif
+        std::vector<double> checks;
+        total = 0;
+        while (checks.size() < test.paths.size() || total < budget)
+        {
+            for (const auto& path : test.paths)
+            {
+                auto start = clock_type::now();
+                allowed += robots->allowed(path, agent);
+                checks.push_back(elapsed(start));
+                total += checks.back();
+            }
+        }
+        // Keep the checks from being optimized away
+        if (allowed > checks.size() + test.paths.size())
+        {
+            std::cerr << "Impossible" << std::endl;
+        }
+        result.checks = checks.size();
+        result.checks_per_s = checks.size() / (total / 1e9);
+        result.check_ns_p50 = percentile(checks, 0.5);
+        result.check_ns_p99 = percentile(checks, 0.99);
+        return result;
+    }
+
+    void csv(const std::vector<Result>& results)
+    {
+        std::cout << "case,bytes,parses,parse_mb_per_s,parse_docs_per_s,parse_ns_p50,"
+                  << "parse_ns_p99,memory_bytes,checks,checks_per_s,check_ns_p50,"
+                  << "check_ns_p99"
+#ifdef REP_COUNT_ALLOCATIONS
+                  << ",allocations_per_parse,allocations_per_check,heap_bytes"
+#endif
+                  << std::endl;
+        for (const auto& result : results)
+        {
+            std::cout << result.name << "," << result.bytes << "," << result.parses << ","
+                      << result.parse_mb_per_s << "," << result.parse_docs_per_s << ","
+                      << result.parse_ns_p50 << "," << result.parse_ns_p99 << ","
+                      << result.memory_bytes << "," << result.checks << ","
+                      << result.checks_per_s << "," << result.check_ns_p50 << ","
+                      << result.check_ns_p99
+#ifdef REP_COUNT_ALLOCATIONS
+                      << "," << result.allocations_per_parse << ","
+                      << result.allocations_per_check << "," << result.heap_bytes
+#endif
+                      << std::endl;
+        }
+    }
+
+    void json(const std::vector<Result>& results)
+    {
+        std::cout << "[" << std::endl;
+        for (size_t index = 0; index < results.size(); ++index)
+        {
+            const Result& result = results[index];
+            std::cout << "  {\"case\": \"" << result.name << "\""
+                      << ", \"bytes\": " << result.bytes
+                      << ", \"parses\": " << result.parses
+                      << ", \"parse_mb_per_s\": " << result.parse_mb_per_s
+                      << ", \"parse_docs_per_s\": " << result.parse_docs_per_s
+                      << ", \"parse_ns_p50\": " << result.parse_ns_p50
+                      << ", \"parse_ns_p99\": " << result.parse_ns_p99
+                      << ", \"memory_bytes\": " << result.memory_bytes
+                      << ", \"checks\": " << result.checks
+                      << ", \"checks_per_s\": " << result.checks_per_s
+                      << ", \"check_ns_p50\": " << result.check_ns_p50
+                      << ", \"check_ns_p99\": " << result.check_ns_p99
+#ifdef REP_COUNT_ALLOCATIONS
+                      << ", \"allocations_per_parse\": " << result.allocations_per_parse
+                      << ", \"allocations_per_check\": " << result.allocations_per_check
+                      << ", \"heap_bytes\": " << result.heap_bytes
+#endif
+                      << "}"
+                      << (index + 1 < results.size() ? "," : "") << std::endl;
+        }
+        std::cout << "]" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    bool as_json = false;
+    double budget = 1e9;
+    std::string dump;
+    for (int index = 1; index < argc; ++index)
+    {
+        if (std::strcmp(argv[index], "--json") == 0)
+        {
+            as_json = true;
+        }
+        else if (std::strcmp(argv[index], "--quick") == 0)
+        {
+            budget = 1e7;
+        }
+        else if (std::strcmp(argv[index], "--dump") == 0 && index + 1 < argc)
+        {
+            dump = argv[++index];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--json] [--quick] [--dump <directory>]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Case> cases = corpus();
+    std::vector<Result> results;
+    for (const auto& test : cases)
+    {
+        if (!dump.empty())
+        {
+            std::ofstream(dump + "/" + test.name + ".txt") << test.content;
+        }
+        results.push_back(measure(test, budget));
+    }
+
+    if (as_json)
+    {
+        json(results);
+    }
+    else
+    {
+        csv(results);
+    }
+    return 0;
+}
@@ -1,9 +1,18 @@
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "bulk.h"
+#include "cache.h"
 #include "directive.h"
+#include "index.h"
+#include "literal.h"
 #include "robots.h"
+#include "snapshot.h"
 
 /**
  * Run func() `count` times in each of `runs` experiments, where `name` provides a
@@ -54,6 +63,140 @@ int main(int argc, char* argv[]) {
         directive.match("/path/is/with/a/few/wildcards/");
     });
 
+    // One of each kind of directive, which each have their own match kernel
+    std::vector<std::pair<std::string, std::string>> kinds = {
+        {"prefix", "/basic/path"},
+        {"exact", "/basic/path/other$"},
+        {"infix", "/basic/*/other"},
+        {"suffix", "/basic/*.html$"},
+        {"general", "/basic/*/o*r"}
+    };
+    std::string kind_path("/basic/path/other.html");
+    for (const auto& kind : kinds)
+    {
+        Rep::Directive example(kind.second, true);
+        bench("directive " + kind.first + " check", count, runs,
+            [&example, &kind_path]() {
+                example.match(kind_path);
+            });
+    }
+
+    // Every '*' could be tried at every position, but no position ever matches
+    directive = Rep::Directive("/*a*a*a*a*a*a*a*a*b", true);
+    std::string pathological("/" + std::string(2000, 'a'));
+    bench("directive pathological check", count / 100, runs, [directive, pathological]() {
+        directive.match(pathological);
+    });
+
+    std::string literal("/some/fairly/long/literal/directive/path.html");
+    std::string candidate(literal);
+    bench("literal equal", count, runs, [&literal, &candidate]() {
+        Rep::Literal::equal(literal.data(), candidate.data(), literal.size());
+    });
+
+    std::string haystack("/" + std::string(200, 'a') + "/needle.html");
+    std::string needle("/needle.");
+    bench("literal search", count, runs, [&haystack, &needle]() {
+        Rep::Literal::search(haystack.data(), haystack.data() + haystack.size(),
+                             needle.data(), needle.size());
+    });
+
+    Rep::Agent agent("a.com");
+    for (size_t section = 0; section < 200; ++section)
+    {
+        std::string prefix("/section-" + std::to_string(section) + "/");
+        agent.disallow(prefix).allow(prefix + "*.html$");
+    }
+    bench("agent check", count / 10, runs, [&agent]() {
+        agent.allowed("/section-150/page.html");
+    });
+
+    // The same check, for a path that is already escaped and needs no URL parsing
+    std::string path("/section-150/page.html");
+    bench("agent path check", count / 10, runs, [&agent, &path]() {
+        agent.allowed_path(path);
+    });
+
+    // Adding rules normalizes each one, as a path rather than as a full URL
+    bench("agent add rules", count / 1000, runs, []() {
+        Rep::Agent rules("a.com");
+        for (size_t section = 0; section < 200; ++section)
+        {
+            std::string prefix("/section-" + std::to_string(section) + "/");
+            rules.disallow(prefix).allow(prefix + "*.html$");
+        }
+    });
+
+    // Sections whose subdirectories are disallowed again, one by one
+    Rep::Agent redundant("a.com");
+    for (size_t section = 0; section < 200; ++section)
+    {
+        std::string prefix("/section-" + std::to_string(section) + "/");
+        redundant.disallow(prefix).disallow(prefix).disallow(prefix + "*.php");
+        for (size_t page = 0; page < 5; ++page)
+        {
+            redundant.disallow(prefix + "page-" + std::to_string(page));
+        }
+    }
+    bench("agent minimize", count / 1000, runs, [&redundant]() {
+        Rep::Agent(redundant).minimize();
+    });
+    Rep::Agent minimized = Rep::Agent(redundant).minimize();
+    bench("redundant agent check", count / 10, runs, [&redundant]() {
+        redundant.allowed_path("/section-199/index.html");
+    });
+    bench("minimized agent check", count / 10, runs, [&minimized]() {
+        minimized.allowed_path("/section-199/index.html");
+    });
+
+    // A large site's rules: 5000 across many sections, a few flat paths and wildcards
+    std::string large("User-agent: *\n");
+    for (size_t rule = 0; rule < 5000; ++rule)
+    {
+        if (rule % 100 == 0)
+        {
+            large += "Disallow: /*.cgi?session=" + std::to_string(rule) + "\n";
+        }
+        else if (rule % 10 == 0)
+        {
+            large += "Disallow: /product-" + std::to_string(rule) + "\n";
+        }
+        else
+        {
+            large += (rule % 3 ? "Disallow: /category-" : "Allow: /category-") +
+                std::to_string(rule % 700) + "/filter-" + std::to_string(rule) + "\n";
+        }
+    }
+    bench("parse 5000 rules", count / 10000, runs, [large]() {
+        Rep::Robots robot(large);
+    });
+    Rep::Agent scanned = Rep::Robots(large).agent("agent");
+    Rep::Agent bucketed(scanned);
+    scanned.allow("/unused");
+    bucketed.allow("/unused").bucket();
+    Rep::Agent automaton = Rep::Agent(scanned).compile();
+    std::vector<std::string> large_paths = {
+        "/category-150/filter-3150/page", "/category-42/list.html", "/product-990",
+        "/about.html"
+    };
+    for (const auto& candidate : std::vector<std::pair<std::string, Rep::Agent*>>{
+             {"linear", &scanned}, {"bucketed", &bucketed}, {"compiled", &automaton}})
+    {
+        Rep::Agent* subject = candidate.second;
+        bench("5000 rule " + candidate.first + " check", count / 10, runs,
+            [subject, &large_paths]() {
+                for (const auto& path : large_paths)
+                {
+                    subject->allowed_path(path);
+                }
+            });
+    }
+
+    Rep::Agent compiled = Rep::Agent(agent).compile();
+    bench("compiled agent check", count / 10, runs, [&compiled]() {
+        compiled.allowed("/section-150/page.html");
+    });
+
     std::string content =
         "# /robots.txt for http://www.fict.org/\n"
         "# comments to webmaster@fict.org\n"
@@ -74,4 +217,155 @@ int main(int argc, char* argv[]) {
     bench("parse RFC", count / 10, runs, [content]() {
         Rep::Robots robot(content);
     });
+
+    const char* buffer = content.data();
+    size_t length = content.size();
+    bench("parse RFC buffer", count / 10, runs, [buffer, length]() {
+        Rep::Robots robot(buffer, length, "");
+    });
+
+    Rep::Robots::Options options;
+    options.arena = true;
+    bench("parse RFC arena", count / 10, runs, [content, options]() {
+        Rep::Robots robot(content, "", options);
+    });
+
+    Rep::Robots::Options lazy;
+    lazy.lazy = true;
+    bench("parse RFC lazy", count / 10, runs, [content, lazy]() {
+        Rep::Robots robot(content, "", lazy);
+    });
+
+    // Many groups, of which only one is ever looked up
+    std::string groups;
+    for (size_t group = 0; group < 50; ++group)
+    {
+        groups += "User-agent: agent-" + std::to_string(group) + "\n";
+        for (size_t rule = 0; rule < 20; ++rule)
+        {
+            groups += "Disallow: /section-" + std::to_string(rule) + "/*.html$\n";
+        }
+    }
+    bench("parse 50 groups and check one", count / 1000, runs, [groups]() {
+        Rep::Robots(groups).allowed("/section-5/page.html", "agent-5");
+    });
+    bench("parse 50 groups lazily and check one", count / 1000, runs, [groups, lazy]() {
+        Rep::Robots(groups, "", lazy).allowed("/section-5/page.html", "agent-5");
+    });
+
+    Rep::Robots::Options selected;
+    selected.agents = {"my-agent"};
+    bench("parse RFC selected agents", count / 10, runs, [content, selected]() {
+        Rep::Robots robot(content, "", selected);
+    });
+
+    Rep::Robots robots(content);
+    std::vector<std::string> urls;
+    for (size_t index = 0; index < 1000; ++index)
+    {
+        urls.push_back("/org/" + std::to_string(index) + "/page.html");
+    }
+    bench("robots check 1000 URLs", count / 1000, runs, [&robots, &urls]() {
+        for (const auto& url : urls)
+        {
+            robots.allowed(url, "my-agent");
+        }
+    });
+
+    Rep::Robots::AgentRef resolved = robots.resolve("my-agent");
+    bench("robots resolved check 1000 URLs", count / 1000, runs,
+        [&robots, &urls, resolved]() {
+            for (const auto& url : urls)
+            {
+                robots.allowed(url, resolved);
+            }
+        });
+
+    std::vector<bool> results;
+    bench("robots batch check 1000 URLs", count / 1000, runs,
+        [&robots, &urls, &results]() {
+            robots.allowed_batch(urls, "my-agent", results);
+        });
+
+    std::string serialized = Rep::Robots(content).serialize();
+    bench("load RFC snapshot", count, runs, [&serialized]() {
+        Rep::Snapshot snapshot(serialized.data(), serialized.size());
+    });
+
+    // Each thread checks its own share of the URLs against a shared cache of many
+    // sites, so the total rate should scale with the number of threads
+    Rep::RobotsCache cache(1 << 30, std::chrono::hours(1));
+    std::vector<std::string> site_urls;
+    for (size_t site = 0; site < 10000; ++site)
+    {
+        std::string base("http://site-" + std::to_string(site) + ".com/");
+        cache.insert(base, content);
+        site_urls.push_back(base + "org/page.html");
+    }
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= cores; threads *= 2)
+    {
+        bench("cache check 10000 URLs on " + std::to_string(threads) + " threads",
+            count / 100000, runs, [&cache, &site_urls, threads]() {
+                std::vector<std::thread> workers;
+                for (size_t worker = 0; worker < threads; ++worker)
+                {
+                    workers.emplace_back([&cache, &site_urls, worker, threads]() {
+                        for (size_t index = worker; index < site_urls.size();
+                             index += threads)
+                        {
+                            cache.allowed(site_urls[index], "my-agent");
+                        }
+                    });
+                }
+                for (auto& thread : workers)
+                {
+                    thread.join();
+                }
+            });
+    }
+
+    // A frontier segment of a million URLs, interleaved across 10000 sites
+    Rep::RobotsIndex index("my-agent");
+    std::vector<std::string> frontier;
+    for (size_t site = 0; site < 10000; ++site)
+    {
+        index.insert("http://site-" + std::to_string(site) + ".com/", content);
+    }
+    for (size_t url = 0; url < 1000000; ++url)
+    {
+        frontier.push_back("http://site-" + std::to_string(url % 10000) + ".com/org/" +
+                           std::to_string(url) + "/page.html");
+    }
+    std::vector<bool> filtered;
+    bench("index filter 1000000 URLs from 10000 sites", 1, runs,
+        [&index, &frontier, &filtered]() {
+            index.allowed_batch(frontier, filtered);
+        });
+
+    // Per-thread throughput of bulk parsing, for a few batch sizes
+    std::vector<Rep::document_t> documents;
+    for (size_t index = 0; index < 100000; ++index)
+    {
+        documents.emplace_back(
+            "http://site-" + std::to_string(index) + ".com/robots.txt", content);
+    }
+    for (size_t batch : {1, 64, 1024})
+    {
+        Rep::BulkOptions options;
+        options.batch = batch;
+        std::vector<Rep::BulkStats> stats;
+        bench("parse many RFC with batches of " + std::to_string(batch), 1, runs,
+            [&documents, &options, &stats]() {
+                Rep::parse_many(documents, options, &stats);
+            });
+        for (size_t thread = 0; thread < stats.size(); ++thread)
+        {
+            const Rep::BulkStats& result = stats[thread];
+            std::cout << "    Thread " << thread << ": " << result.documents
+                      << " documents, " << (result.documents / result.seconds / 1000)
+                      << " k-docs / s, " << (result.bytes / result.seconds / 1e6)
+                      << " MB / s, " << result.steals << " steals" << std::endl;
+        }
+    }
 }
@@ -1,9 +1,12 @@
 #ifndef AGENT_CPP_H
 #define AGENT_CPP_H
 
+#include <memory>
 #include <vector>
 
+#include "arena.h"
 #include "directive.h"
+#include "stats.h"
 
 // forward declaration
 namespace Url
@@ -13,32 +16,53 @@ namespace Url
 
 namespace Rep
 {
+    // forward declarations
+    class Automaton;
+    class Buckets;
+    class RulePool;
+
+    /**
+     * The rules for a single user-agent. Directives are kept in priority order as
+     * they are added, so that once an Agent has been built, none of its const
+     * methods modify it, and it may be shared and checked from many threads at once
+     * without locking.
+     */
     class Agent
     {
     public:
         /* The type for the delay. */
         typedef float delay_t;
 
+        /* The type of the container of directives. */
+        typedef std::vector<Directive, ArenaAllocator<Directive>> directives_t;
+
         /**
          * Default constructor
          */
         Agent() : Agent("") {}
 
         /**
-         * Construct an agent.
+         * Construct an agent, storing its directives in the arena if one is provided.
          */
-        explicit Agent(const std::string& host) :
-            directives_(), delay_(-1.0), sorted_(true), host_(host) {}
+        explicit Agent(const std::string& host, Arena* arena = nullptr);
 
         /**
-         * Default copy constructor.
+         * Copy rhs. Directives on the heap are shared with rhs until either adds
+         * another, while those in an arena are copied onto the heap.
          */
-        Agent(const Agent& rhs) = default;
+        Agent(const Agent& rhs);
 
         /**
-         * Default move constructor.
+         * Copy rhs, storing its directives in the provided arena. Directives already
+         * in that arena, or both on the heap, are shared.
          */
-        Agent(Agent&& rhs) = default;
+        Agent(const Agent& rhs, Arena* arena);
+
+        /**
+         * Move rhs. Its directives are shared rather than taken, so that rhs is
+         * left with valid (if uncompiled) rules.
+         */
+        Agent(Agent&& rhs) noexcept;
 
         /**
          * Add an allowed directive.
@@ -66,27 +90,160 @@ namespace Rep
         /**
          * A vector of the directives, in priority-sorted order.
          */
-        const std::vector<Directive>& directives() const;
+        const directives_t& directives() const { return *directives_; }
+
+        /**
+         * Remove the directives that can never change the outcome of a check: exact
+         * duplicates, and rules whose every match is already decided the same way by
+         * another rule. Only rules that are provably redundant are removed, so that
+         * every path is allowed or disallowed exactly as before. This discards any
+         * automaton, buckets or stats, unless nothing is removed.
+         */
+        Agent& minimize();
+
+        /**
+         * Combine all of the directives into a single automaton, so that checks take
+         * one pass over the path rather than trying each directive in turn. Adding a
+         * directive afterwards discards the automaton.
+         */
+        Agent& compile();
+
+        /**
+         * Group the directives by how their paths start (see Buckets), so that
+         * checks only try those that could match, rather than each in turn. Results
+         * are unchanged. Adding a directive afterwards discards the groups, and a
+         * compiled automaton is used in their place if there is one.
+         */
+        Agent& bucket();
+
+        /**
+         * Record the outcome and latency of every check of this agent in a new Stats,
+         * which copies of the agent share. Adding a directive afterwards discards the
+         * stats, since their counts are by directive. This does nothing unless the
+         * library is built with REP_STATS defined.
+         */
+        Agent& instrument();
+
+        /**
+         * The stats recorded since instrument() was called, or nullptr if none are
+         * being recorded.
+         */
+        const Stats* stats() const { return stats_.get(); }
 
         /**
          * Return true if the URL (either a full URL or a path) is allowed.
          */
         bool allowed(const std::string& path) const;
 
+        /**
+         * Return true if the path is allowed. Unlike allowed, the path is trusted to
+         * be already escaped and defragmented, and is not parsed as a URL.
+         */
+        bool allowed_path(const char* path, size_t length) const;
+
+        /**
+         * As above, for a path in a string.
+         */
+        bool allowed_path(const std::string& path) const
+        {
+            return allowed_path(path.data(), path.size());
+        }
+
+        /**
+         * Check each URL (either a full URL or a path), setting the corresponding
+         * entry of results to whether it is allowed. results is resized to match.
+         */
+        void allowed_batch(
+            const std::vector<std::string>& paths, std::vector<bool>& results) const;
+
+        /**
+         * The bytes of memory used by the agent, including its directives and any
+         * compiled automaton or buckets. Directives stored in an arena are left to
+         * whatever owns the arena to account for, while those shared with other
+         * agents are counted in full by each of them.
+         */
+        size_t memory_usage() const;
+
         std::string str() const;
 
         /**
-         * Default copy assignment operator.
+         * Copy rhs, sharing its directives as the copy constructor does.
          */
-        Agent& operator=(const Agent& rhs) = default;
+        Agent& operator=(const Agent& rhs);
+
+        /**
+         * Move rhs, sharing its directives as the move constructor does.
+         */
+        Agent& operator=(Agent&& rhs) noexcept;
 
     private:
+        friend class RulePool;
+        friend class Robots;
+
+        /**
+         * Copy directives into a new container in the arena (or on the heap).
+         */
+        static std::shared_ptr<directives_t> clone(
+            const directives_t& directives, Arena* arena);
+
         bool is_external(const Url::Url& url) const;
 
-        mutable std::vector<Directive> directives_;
+        /**
+         * Put the escaped path of the query into path, returning false instead if
+         * the query is for another host.
+         */
+        bool normalize(const std::string& query, std::string& path) const;
+
+        /**
+         * Return true if the escaped path is allowed.
+         */
+        bool check(const char* path, size_t length) const;
+
+        /**
+         * Return the index of the directive that decides whether the escaped path is
+         * allowed, or Automaton::npos if none match.
+         */
+        size_t match(const char* path, size_t length) const;
+
+        /**
+         * The arena directives are stored in, if any.
+         */
+        Arena* arena() const { return directives_->get_allocator().arena(); }
+
+        /**
+         * Add an allow or disallow directive for the rule.
+         */
+        Agent& rule(const std::string& query, bool allowed);
+
+        /**
+         * Insert the directive after any others of the same or higher priority, or
+         * append it if the directives are yet to be sorted.
+         */
+        void add(Directive&& directive);
+
+        /**
+         * Append the directives added from now on, leaving sort() to put them in
+         * priority order once the agent has been built, rather than inserting each.
+         */
+        void unsorted() { sorted_ = false; }
+
+        /**
+         * Put the directives appended since unsorted() in priority order.
+         */
+        void sort();
+
+        /**
+         * Directives may be shared between agents, and are copied before being
+         * modified if they are.
+         */
+        std::shared_ptr<directives_t> directives_;
         delay_t delay_;
-        mutable bool sorted_;
+        // Whether the directives are in priority order, or are yet to be sorted
+        bool sorted_;
         std::string host_;
+        std::shared_ptr<const Automaton> compiled_;
+        std::shared_ptr<const Buckets> buckets_;
+        std::shared_ptr<Stats> stats_;
     };
 }
 
@@ -0,0 +1,116 @@
+#ifndef ARENA_CPP_H
+#define ARENA_CPP_H
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Rep
+{
+
+    /**
+     * A monotonic arena. Allocations are carved out of a few large blocks and are
+     * only released, all at once, when the arena is destroyed.
+     */
+    class Arena
+    {
+    public:
+        /**
+         * Create an arena whose first block holds block_size bytes. Later blocks
+         * double in size.
+         */
+        explicit Arena(size_t block_size = 4096);
+
+        Arena(const Arena& rhs) = delete;
+        Arena& operator=(const Arena& rhs) = delete;
+
+        /**
+         * Return size bytes aligned to alignment.
+         */
+        void* allocate(size_t size, size_t alignment);
+
+        /**
+         * The number of blocks allocated.
+         */
+        size_t blocks() const { return blocks_.size(); }
+
+        /**
+         * The total size of all the blocks allocated.
+         */
+        size_t capacity() const { return capacity_; }
+
+    private:
+        std::vector<std::unique_ptr<char[]>> blocks_;
+        char* current_;
+        size_t remaining_;
+        size_t block_size_;
+        size_t capacity_;
+    };
+
+    /**
+     * An allocator that draws from an Arena, or from the heap when it has none.
+     *
+     * Copies of a container never share the original's arena, so that they can
+     * outlive it safely.
+     */
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        typedef T value_type;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        ArenaAllocator() : arena_(nullptr) {}
+
+        explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& rhs) : arena_(rhs.arena()) {}
+
+        T* allocate(size_t count)
+        {
+            if (arena_)
+            {
+                return static_cast<T*>(arena_->allocate(count * sizeof(T), alignof(T)));
+            }
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+
+        void deallocate(T* pointer, size_t)
+        {
+            if (!arena_)
+            {
+                ::operator delete(pointer);
+            }
+        }
+
+        ArenaAllocator select_on_container_copy_construction() const
+        {
+            return ArenaAllocator();
+        }
+
+        /**
+         * The arena this allocates from, or nullptr for the heap.
+         */
+        Arena* arena() const { return arena_; }
+
+    private:
+        Arena* arena_;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs)
+    {
+        return lhs.arena() == rhs.arena();
+    }
+
+    template <typename T, typename U>
+    bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs)
+    {
+        return lhs.arena() != rhs.arena();
+    }
+
+}
+
+#endif
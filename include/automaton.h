@@ -0,0 +1,87 @@
+#ifndef AUTOMATON_CPP_H
+#define AUTOMATON_CPP_H
+
+#include <string>
+#include <vector>
+
+#include "agent.h"
+#include "directive.h"
+
+namespace Rep
+{
+
+    /**
+     * A single matcher built from a set of directives. Literal rules share a prefix
+     * trie, and `*` / `$` rules are threaded into the same trie as self-looping and
+     * anchored states, so every directive is evaluated in one pass over the path.
+     */
+    class Automaton
+    {
+    public:
+        /**
+         * Returned by match when no directive matches.
+         */
+        static const size_t npos;
+
+        /**
+         * Build an automaton from priority-sorted directives.
+         */
+        explicit Automaton(const Agent::directives_t& directives);
+
+        /**
+         * Return the index of the winning directive for the path, or npos if none
+         * match. The winner is the matching directive with the highest priority,
+         * preferring an allow on a tie. The path is expected to be properly escaped.
+         */
+        size_t match(const std::string& path) const;
+
+        /**
+         * As above, for the path of the given length.
+         */
+        size_t match(const char* path, size_t length) const;
+
+        /**
+         * The bytes of memory used by the automaton.
+         */
+        size_t memory_usage() const;
+
+    private:
+        struct Node
+        {
+            Node() : first(0), last(0), star(0), loop(false),
+                     prefix(Automaton::npos), anchored(Automaton::npos) {}
+
+            // The range of this node's edges in edges_
+            size_t first;
+            size_t last;
+            // The node reached on '*', if any (0 is always the root)
+            size_t star;
+            // Whether this node was reached on '*' and so consumes any character
+            bool loop;
+            // The best directive ending at this node, and ending here with a '$'
+            size_t prefix;
+            size_t anchored;
+        };
+
+        typedef std::pair<char, size_t> edge_t;
+        typedef std::pair<Directive::priority_t, bool> rule_t;
+
+        std::vector<rule_t> rules_;
+        std::vector<Node> nodes_;
+        std::vector<edge_t> edges_;
+        bool wildcards_;
+
+        /**
+         * Return the node reached from node on chr, or 0 if there is none.
+         */
+        size_t next(size_t node, char chr) const;
+
+        /**
+         * Return whichever of the two directive indices should win.
+         */
+        size_t better(size_t current, size_t candidate) const;
+    };
+
+}
+
+#endif
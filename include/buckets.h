@@ -0,0 +1,77 @@
+#ifndef BUCKETS_CPP_H
+#define BUCKETS_CPP_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "agent.h"
+
+namespace Rep
+{
+
+    /**
+     * The directives of an agent grouped by a key: the start of their leading
+     * literal, up to the end of its first path segment. A path can only be matched by
+     * directives whose key it starts with, so a check only tries the groups for
+     * each distinct length of key, rather than every directive. Directives that
+     * start with a wildcard have the key "/", and so are always tried.
+     *
+     * Groups are found by a hash of their key, computed in one pass along the path.
+     * Directives are still matched in full, so a collision only means trying a few
+     * more of them, and the winner is always the one a linear scan would find.
+     */
+    class Buckets
+    {
+    public:
+        /**
+         * The number of directives from which a Robots groups the directives of each
+         * agent.
+         */
+        static const size_t minimum = 16;
+
+        /**
+         * Group priority-sorted directives.
+         */
+        explicit Buckets(const Agent::directives_t& directives);
+
+        /**
+         * Return the index of the winning directive among those the buckets were
+         * built from, or Automaton::npos if none match. The winner is the matching
+         * directive with the highest priority, preferring an allow on a tie, and then
+         * the first. The path is expected to be properly escaped.
+         */
+        size_t match(const Agent::directives_t& directives,
+                     const char* path, size_t length) const;
+
+        /**
+         * The bytes of memory used by the buckets.
+         */
+        size_t memory_usage() const;
+
+    private:
+        typedef std::unordered_map<uint64_t, std::vector<size_t>> buckets_t;
+
+        /**
+         * Return the length of the key of the directive.
+         */
+        static size_t key(const Directive& directive);
+
+        /**
+         * Extend the hash of a key by one character.
+         */
+        static uint64_t mix(uint64_t hash, char chr)
+        {
+            // FNV-1a
+            return (hash ^ static_cast<unsigned char>(chr)) * 1099511628211ull;
+        }
+
+        // The indices of the directives with each key, in priority order
+        buckets_t buckets_;
+        // The distinct lengths of the keys, in ascending order
+        std::vector<size_t> lengths_;
+    };
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef BULK_CPP_H
+#define BULK_CPP_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "robots.h"
+
+namespace Rep
+{
+
+    /**
+     * Options controlling how many robots.txt files are parsed at once.
+     */
+    struct BulkOptions
+    {
+        BulkOptions() : threads(0), batch(64), robots() {}
+
+        /**
+         * The number of threads to parse with, or 0 for one per core.
+         */
+        size_t threads;
+
+        /**
+         * The number of documents a thread takes at a time, from its own work or from
+         * another thread's when it runs out. Smaller batches balance better, and larger
+         * ones contend less.
+         */
+        size_t batch;
+
+        /**
+         * The options each robots.txt is parsed with.
+         */
+        Robots::Options robots;
+    };
+
+    /**
+     * The work done by one thread.
+     */
+    struct BulkStats
+    {
+        BulkStats() : documents(0), bytes(0), failures(0), steals(0), seconds(0) {}
+
+        size_t documents;
+        size_t bytes;
+        // Documents whose base URL could not be parsed
+        size_t failures;
+        // Times this thread took work from another
+        size_t steals;
+        double seconds;
+    };
+
+    /**
+     * A robots.txt body and the base URL it was fetched from.
+     */
+    typedef std::pair<std::string, std::string> document_t;
+
+    /**
+     * Parse each (base_url, body) document across a pool of threads, which take work
+     * from each other as they finish their own. Each result is null if its base URL
+     * could not be parsed. The work of each thread is stored in stats, if provided.
+     */
+    std::vector<std::unique_ptr<Robots>> parse_many(
+        const std::vector<document_t>& documents,
+        const BulkOptions& options = BulkOptions(),
+        std::vector<BulkStats>* stats = nullptr);
+
+    /**
+     * As above, but serializing each robots.txt to a snapshot (see Robots::serialize).
+     * Each result is empty if its base URL could not be parsed.
+     */
+    std::vector<std::string> serialize_many(
+        const std::vector<document_t>& documents,
+        const BulkOptions& options = BulkOptions(),
+        std::vector<BulkStats>* stats = nullptr);
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef CACHE_CPP_H
+#define CACHE_CPP_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "robots.h"
+
+namespace Rep
+{
+
+    /**
+     * A cache of parsed robots.txt files, keyed by the robots.txt URL of each site (see
+     * Robots::robotsUrl), which may be shared by many threads.
+     *
+     * Sites are spread across shards, each with its own lock, so that threads checking
+     * different sites rarely contend. Each shard holds an equal part of the memory
+     * budget and evicts with the CLOCK algorithm, an approximation of LRU whose hits
+     * only set a bit. Entries expire after a fixed time to live, but are kept until
+     * evicted or replaced so that they can still be used while being refetched.
+     */
+    class RobotsCache
+    {
+    public:
+        typedef std::chrono::steady_clock clock_type;
+
+        /**
+         * Whether a site was cached, and if so whether it has expired.
+         */
+        enum class Status
+        {
+            hit,
+            miss,
+            stale
+        };
+
+        /**
+         * The result of a check. For a miss, allowed is always true.
+         */
+        struct Result
+        {
+            Status status;
+            bool allowed;
+        };
+
+        /**
+         * Create a cache holding up to budget bytes, whose entries expire ttl after
+         * they are inserted.
+         */
+        RobotsCache(size_t budget, clock_type::duration ttl, size_t shards = 16);
+
+        RobotsCache(const RobotsCache& rhs) = delete;
+        RobotsCache& operator=(const RobotsCache& rhs) = delete;
+
+        /**
+         * Parse the content of the robots.txt for the site of url, and cache it in
+         * place of any existing entry, accounting for it by its memory usage. Throws
+         * if url cannot be parsed.
+         */
+        void insert(const std::string& url, const std::string& content,
+                    clock_type::time_point now = clock_type::now());
+
+        /**
+         * Cache robots for the site of url, accounting for it as size bytes.
+         */
+        void insert(const std::string& url, std::shared_ptr<const Robots> robots,
+                    size_t size, clock_type::time_point now = clock_type::now());
+
+        /**
+         * Return the cached robots.txt for the site of url, or nullptr if there is
+         * none, setting status accordingly.
+         */
+        std::shared_ptr<const Robots> find(
+            const std::string& url, Status& status,
+            clock_type::time_point now = clock_type::now());
+
+        /**
+         * Check whether agent may fetch url, according to the cached robots.txt for
+         * its site.
+         */
+        Result allowed(const std::string& url, const std::string& agent,
+                       clock_type::time_point now = clock_type::now());
+
+        /**
+         * Remove the entry for the site of url, if any.
+         */
+        void erase(const std::string& url);
+
+        /**
+         * The number of sites cached.
+         */
+        size_t size() const;
+
+        /**
+         * The number of bytes accounted for by the cached sites.
+         */
+        size_t usage() const;
+
+    private:
+        struct Entry
+        {
+            Entry() : key(), robots(), size(0), expires(), referenced(false) {}
+
+            std::string key;
+            std::shared_ptr<const Robots> robots;
+            size_t size;
+            clock_type::time_point expires;
+            bool referenced;
+        };
+
+        struct Shard
+        {
+            Shard() : mutex(), index(), entries(), free(), hand(0), usage(0) {}
+
+            mutable std::mutex mutex;
+            std::unordered_map<std::string, size_t> index;
+            // Slots visited by the clock hand; empty slots have no robots
+            std::vector<Entry> entries;
+            std::vector<size_t> free;
+            size_t hand;
+            size_t usage;
+        };
+
+        /**
+         * Return the shard for the key.
+         */
+        Shard& shard(const std::string& key);
+
+        /**
+         * Remove the entry in the slot. The shard must be locked.
+         */
+        static void remove(Shard& shard, size_t slot);
+
+        /**
+         * Evict entries until the shard is within its budget. The shard must be locked.
+         */
+        void evict(Shard& shard);
+
+        size_t budget_;
+        clock_type::duration ttl_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+    };
+
+}
+
+#endif
@@ -1,6 +1,10 @@
 #ifndef DIRECTIVE_CPP_H
 #define DIRECTIVE_CPP_H
 
+#include <cstdint>
+#include <string>
+
+#include "arena.h"
 
 namespace Rep
 {
@@ -13,6 +17,29 @@ namespace Rep
          */
         typedef size_t priority_t;
 
+        /**
+         * The type of the stored expression.
+         */
+        typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>
+            string_t;
+
+        /**
+         * The shapes of expression that have their own match kernels.
+         */
+        enum class Kind : uint8_t
+        {
+            // A literal prefix, such as "/path"
+            prefix,
+            // A literal anchored to the end, such as "/path$"
+            exact,
+            // Two literal runs around one '*', such as "/path*.html"
+            infix,
+            // As above, anchored to the end, such as "/*.php$"
+            suffix,
+            // Anything else
+            general
+        };
+
         /**
          * Default constructor disallowed.
          */
@@ -24,6 +51,16 @@ namespace Rep
          */
         Directive(const std::string& line, bool allowed);
 
+        /**
+         * As above, but storing the expression in the provided arena.
+         */
+        Directive(const std::string& line, bool allowed, Arena* arena);
+
+        /**
+         * Copy rhs, storing the expression in the provided arena.
+         */
+        Directive(const Directive& rhs, Arena* arena);
+
         /**
          * Default copy constructor.
          */
@@ -48,6 +85,43 @@ namespace Rep
          */
         bool match(const std::string& path) const;
 
+        /**
+         * As above, for the path of the given length.
+         */
+        bool match(const char* path, size_t length) const;
+
+        /**
+         * Return true if p_begin -> p_end matches the expression e_begin -> e_end.
+         *
+         * Each literal run between '*'s is matched at its leftmost position in what
+         * remains of the path, which never does worse than a later position. So no
+         * backtracking is needed, and this takes at most O(|path| x |expression|).
+         */
+        static bool match(const char* e_begin, const char* e_end,
+                          const char* p_begin, const char* p_end);
+
+        /**
+         * The expression with consecutive and trailing '*'s removed.
+         */
+        const string_t& expression() const
+        {
+            return expression_;
+        }
+
+        /**
+         * The shape of the expression, which decides how it is matched.
+         */
+        Kind kind() const
+        {
+            return kind_;
+        }
+
+        /**
+         * The length of the literal run at the start of the expression, before any
+         * '*' or '$', which every path the directive matches starts with.
+         */
+        size_t lead() const;
+
         /**
          * Whether this rule is for an allow or a disallow.
          */
@@ -56,6 +130,12 @@ namespace Rep
             return allowed_;
         }
 
+        /**
+         * The bytes of memory used by the directive, including its expression unless
+         * that is stored in an arena.
+         */
+        size_t memory_usage() const;
+
         std::string str() const;
 
         /**
@@ -63,18 +143,29 @@ namespace Rep
          */
         Directive& operator=(const Directive& rhs) = default;
 
+        /**
+         * Default move assignment operator.
+         */
+        Directive& operator=(Directive&& rhs) = default;
+
     private:
-        std::string expression_;
-        priority_t priority_;
-        bool allowed_;
+        /**
+         * Set the kind of the expression, and where its '*' is if it has one.
+         */
+        void classify();
 
         /**
-         * Return true if p_begin -> p_end matches the expression e_begin -> e_end.
+         * Match the path with the kernel for the kind of expression.
          */
-        bool match(const std::string::const_iterator& e_begin,
-                   const std::string::const_iterator& e_end,
-                   const std::string::const_iterator& p_begin,
-                   const std::string::const_iterator& p_end) const;
+        template <Kind kind>
+        bool match(const char* path, size_t length) const;
+
+        string_t expression_;
+        priority_t priority_;
+        bool allowed_;
+        Kind kind_;
+        // The length of the run before the '*' of an infix or suffix expression
+        uint32_t star_;
     };
 
 }
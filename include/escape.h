@@ -0,0 +1,26 @@
+#ifndef ESCAPE_CPP_H
+#define ESCAPE_CPP_H
+
+#include <string>
+
+namespace Rep
+{
+
+    /**
+     * Escaping of paths exactly as Url::Url escapes them, but without the cost of
+     * parsing a whole URL.
+     */
+    namespace Escape
+    {
+        /**
+         * Put the escaped and defragmented path in begin -> end into result. Only
+         * paths that start with a '/' (but not "//") or a '*' are handled, since they
+         * can never be absolute URLs; return false for any others. A '*' at the start
+         * is preceded by a '/'.
+         */
+        bool path(const char* begin, const char* end, std::string& result);
+    }
+
+}
+
+#endif
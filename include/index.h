@@ -0,0 +1,105 @@
+#ifndef INDEX_CPP_H
+#define INDEX_CPP_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "agent.h"
+#include "robots.h"
+
+namespace Rep
+{
+
+    /**
+     * The compiled rules of one agent for many sites, keyed by the robots.txt URL of
+     * each site (see Robots::robotsUrl), for filtering URLs from any of them.
+     *
+     * Batches of URLs are grouped by site, so that each site is looked up once per
+     * batch and its URLs are checked together while its rules are in cache. Paths
+     * are escaped without parsing whole URLs. Like a Robots, an index may be queried
+     * from many threads at once, but must not be modified meanwhile.
+     */
+    class RobotsIndex
+    {
+    public:
+        /**
+         * Create an index of the rules for the named agent. URLs of sites that have
+         * not been inserted are allowed if missing is true.
+         */
+        explicit RobotsIndex(const std::string& agent, bool missing = true);
+
+        /**
+         * Index the rules of robots for the site of url, in place of any already
+         * indexed. Throws if url cannot be parsed.
+         */
+        void insert(const std::string& url, const Robots& robots);
+
+        /**
+         * Parse the content of the robots.txt for the site of url, building only the
+         * rules of the agent, and index them.
+         */
+        void insert(const std::string& url, const std::string& content);
+
+        /**
+         * Remove the rules for the site of url, if any.
+         */
+        void erase(const std::string& url);
+
+        /**
+         * Whether rules are indexed for the site of url.
+         */
+        bool contains(const std::string& url) const;
+
+        /**
+         * The number of sites indexed.
+         */
+        size_t size() const { return sites_.size(); }
+
+        /**
+         * The bytes of memory used by the index.
+         */
+        size_t memory_usage() const;
+
+        /**
+         * Return true if the agent is allowed to fetch the full URL.
+         */
+        bool allowed(const std::string& url) const;
+
+        /**
+         * Check each full URL, from any mix of sites, setting the corresponding entry
+         * of results to whether it is allowed. results is resized to match.
+         */
+        void allowed_batch(
+            const std::vector<std::string>& urls, std::vector<bool>& results) const;
+
+    private:
+        typedef std::unordered_map<std::string, Agent> sites_t;
+
+        /**
+         * Return the length of the scheme and authority at the start of the URL, or
+         * 0 if it has none.
+         */
+        static size_t authority(const std::string& url);
+
+        /**
+         * Return the rules for the site with the scheme and authority, or nullptr if
+         * there are none.
+         */
+        const Agent* find(const std::string& authority) const;
+
+        /**
+         * Check the URL, whose path starts at the given offset, against the agent.
+         * The buffer is used for the escaped path.
+         */
+        bool check(const Agent* agent, const std::string& url, size_t offset,
+                   std::string& buffer) const;
+
+        std::string agent_;
+        bool missing_;
+        sites_t sites_;
+    };
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef LITERAL_CPP_H
+#define LITERAL_CPP_H
+
+#include <cstddef>
+
+namespace Rep
+{
+
+    /**
+     * Kernels for comparing and finding the literal runs of an expression (the
+     * characters between '*'s) in a path. They are vectorized with AVX2 or SSE2 when
+     * the compiler targets them, and fall back to scalar loops otherwise.
+     */
+    namespace Literal
+    {
+        /**
+         * Return true if the length bytes at lhs and rhs are equal.
+         */
+        bool equal(const char* lhs, const char* rhs, size_t length);
+
+        /**
+         * Return the first occurrence of the length bytes at needle in begin -> end,
+         * or end if there is none. An empty needle is found at begin.
+         */
+        const char* search(const char* begin, const char* end,
+                           const char* needle, size_t length);
+    }
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef PARSER_CPP_H
+#define PARSER_CPP_H
+
+#include <string>
+
+#include "robots.h"
+
+namespace Rep
+{
+
+    /**
+     * Parse a robots.txt incrementally, as it arrives in chunks, with the same results
+     * as parsing it all at once. Only a line split between chunks is buffered, so
+     * parsing overlaps with fetching and the whole body is never held in memory.
+     * The exception is when only some agents are built (see Robots::Options::agents):
+     * the content is then kept until finished, since a wanted agent may turn out to
+     * share the rules of a skipped one, and then it is all parsed again.
+     */
+    class RobotsParser
+    {
+    public:
+        /**
+         * The budget for parsers that accept content of any length.
+         */
+        static const size_t unlimited;
+
+        /**
+         * Start parsing a robots.txt assuming the given base_url. Content past budget
+         * bytes is ignored, as though the robots.txt had been truncated there.
+         */
+        explicit RobotsParser(const std::string& base_url,
+                              const Robots::Options& options = Robots::Options(),
+                              size_t budget = unlimited);
+
+        RobotsParser(const RobotsParser& rhs) = delete;
+        RobotsParser& operator=(const RobotsParser& rhs) = delete;
+
+        /**
+         * Parse the next length bytes of content. Return false once the budget has
+         * been reached, after which there is no need to feed more.
+         */
+        bool feed(const char* data, size_t length);
+
+        /**
+         * Parse any remaining partial line and return the result. The parser may not
+         * be fed or finished again.
+         */
+        Robots finish();
+
+        /**
+         * The number of bytes of content parsed or buffered so far.
+         */
+        size_t consumed() const { return consumed_; }
+
+        /**
+         * Whether content was ignored for being past the budget.
+         */
+        bool truncated() const { return truncated_; }
+
+    private:
+        /**
+         * Apply the lines in begin -> end, which must end at the end of a line.
+         */
+        void parse(const char* begin, const char* end);
+
+        Robots::Options options_;
+        std::string base_url_;
+        Robots robots_;
+        Robots::State state_;
+        // The start of a line that continues in the next chunk
+        std::string partial_;
+        // All the content parsed so far, if only some agents are built
+        std::string content_;
+        size_t budget_;
+        size_t consumed_;
+        bool started_;
+        bool truncated_;
+    };
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef POOL_CPP_H
+#define POOL_CPP_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "agent.h"
+
+namespace Rep
+{
+
+    /**
+     * A content-addressed pool of the directives of agents. Many sites serve identical
+     * rules, and agents interned in the same pool share one immutable, reference
+     * counted copy of each distinct set of directives, across all of their Robots.
+     *
+     * Interned directives are never modified in place, since the pool holds them too,
+     * and sets that only the pool still holds are released as the pool grows. It may
+     * be shared by many threads.
+     */
+    class RulePool
+    {
+    public:
+        RulePool() : mutex_(), sets_() {}
+
+        RulePool(const RulePool& rhs) = delete;
+        RulePool& operator=(const RulePool& rhs) = delete;
+
+        /**
+         * Make agent share the directives of an identical agent interned before, or
+         * intern its directives for later agents to share. Interned directives are
+         * always kept on the heap.
+         */
+        void intern(Agent& agent);
+
+        /**
+         * The number of distinct sets of directives still in use.
+         */
+        size_t size();
+
+    private:
+        typedef std::unordered_multimap<size_t, std::shared_ptr<Agent::directives_t>>
+            sets_t;
+
+        /**
+         * Return a hash of the expressions and verdicts of the directives.
+         */
+        static size_t hash(const Agent::directives_t& directives);
+
+        /**
+         * Return true if the directives have the same expressions and verdicts.
+         */
+        static bool equal(const Agent::directives_t& lhs, const Agent::directives_t& rhs);
+
+        /**
+         * Release the sets that no agent uses any longer. The pool must be locked.
+         */
+        void prune();
+
+        std::mutex mutex_;
+        sets_t sets_;
+    };
+
+}
+
+#endif
@@ -1,11 +1,16 @@
 #ifndef ROBOTS_CPP_H
 #define ROBOTS_CPP_H
 
-#include <sstream>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "agent.h"
+#include "arena.h"
 
 namespace Rep
 {
@@ -13,9 +18,70 @@ namespace Rep
     class Robots
     {
     public:
-        typedef std::unordered_map<std::string, Agent> agent_map_t;
+        typedef std::vector<Agent, ArenaAllocator<Agent>> agents_t;
+        typedef std::unordered_map<
+            std::string,
+            size_t,
+            std::hash<std::string>,
+            std::equal_to<std::string>,
+            ArenaAllocator<std::pair<const std::string, size_t>>> names_t;
         typedef std::vector<std::string> sitemaps_t;
 
+        /**
+         * Options controlling how a robots.txt is parsed and stored.
+         */
+        struct Options
+        {
+            Options()
+                : arena(false), pool(nullptr), agents(), stats(false), lazy(false)
+                , minimize(false) {}
+
+            /**
+             * Store the agents and their directives in one arena owned by the
+             * Robots, rather than in many small heap allocations. Copies of the
+             * agents are made on the heap, so they may outlive the Robots.
+             */
+            bool arena;
+
+            /**
+             * Intern the directives of each agent in this pool, if provided, so that
+             * agents with identical rules share them, even across Robots. Interned
+             * directives are stored on the heap rather than in the arena.
+             */
+            RulePool* pool;
+
+            /**
+             * If not empty, only build the rules of these agents (and of "*"), which
+             * are matched case-insensitively. The groups of all other agents are
+             * skipped without parsing their directives, and those agents get the
+             * rules of "*" instead. The listed agents get the same rules as without
+             * this option, even those sharing a group with a skipped agent.
+             */
+            std::unordered_set<std::string> agents;
+
+            /**
+             * Instrument every agent, so that its checks are recorded in its Stats
+             * (see Agent::instrument). This has no effect unless the library is
+             * built with REP_STATS defined.
+             */
+            bool stats;
+
+            /**
+             * Only find the groups and names of agents while parsing, keeping the
+             * rules of each agent to be parsed the first time it is looked up. This
+             * is cheaper for robots.txt files that are never checked, or only checked
+             * for a few agents. Rules are still parsed just once, even when the
+             * agent is first looked up by many threads at once.
+             */
+            bool lazy;
+
+            /**
+             * Remove the redundant directives of every agent once it is built (see
+             * Agent::minimize), before it is interned or instrumented.
+             */
+            bool minimize;
+        };
+
         /**
          * Create a robots.txt from a utf-8-encoded string.
          */
@@ -25,7 +91,57 @@ namespace Rep
          * Create a robots.txt from a utf-8-encoded string assuming
          * the given base_url.
          */
-        Robots(const std::string& content, const std::string& base_url);
+        Robots(const std::string& content, const std::string& base_url,
+               const Options& options = Options());
+
+        /**
+         * Create a robots.txt from a utf-8-encoded buffer of the given length, assuming
+         * the given base_url. Lines are tokenized in place, without being copied.
+         */
+        Robots(const char* content, size_t length, const std::string& base_url,
+               const Options& options = Options());
+
+        /**
+         * Copy rhs onto the heap, parsing any rules it has yet to parse.
+         */
+        Robots(const Robots& rhs);
+
+        /**
+         * Default move constructor.
+         */
+        Robots(Robots&& rhs) = default;
+
+        /**
+         * Copy rhs, as the copy constructor does.
+         */
+        Robots& operator=(const Robots& rhs);
+
+        /**
+         * Swap with rhs, so that the agents and names rhs is left with are destroyed
+         * along with it, before any arena they are in.
+         */
+        Robots& operator=(Robots&& rhs);
+
+        /**
+         * A cheap, copyable handle to one of the agents of a Robots, resolved once
+         * so that checks need not lowercase and look up the agent name each time.
+         * It is valid for as long as the Robots it came from.
+         */
+        class AgentRef
+        {
+        public:
+            /**
+             * The agent this refers to.
+             */
+            const Agent& agent() const { return *agent_; }
+
+        private:
+            friend class Robots;
+
+            explicit AgentRef(const Agent& agent) : agent_(&agent) {}
+
+            const Agent* agent_;
+        };
 
         /**
          * Get the sitemaps in this robots.txt
@@ -37,29 +153,207 @@ namespace Rep
          */
         const Agent& agent(const std::string& name) const;
 
+        /**
+         * Resolve the agent with the corresponding name to a handle.
+         */
+        AgentRef resolve(const std::string& name) const
+        {
+            return AgentRef(agent(name));
+        }
+
         /**
          * Return true if agent is allowed to fetch the URL (either a
          * full URL or a path).
          */
         bool allowed(const std::string& path, const std::string& name) const;
 
+        /**
+         * Return true if the resolved agent is allowed to fetch the URL (either a
+         * full URL or a path).
+         */
+        bool allowed(const std::string& path, AgentRef agent) const
+        {
+            return agent.agent().allowed(path);
+        }
+
+        /**
+         * Check each URL (either a full URL or a path) for the agent, setting the
+         * corresponding entry of results to whether it is allowed. The agent is
+         * resolved only once, and results is resized to match.
+         */
+        void allowed_batch(const std::vector<std::string>& paths,
+                           const std::string& name,
+                           std::vector<bool>& results) const;
+
+        /**
+         * As above, for a resolved agent.
+         */
+        void allowed_batch(const std::vector<std::string>& paths,
+                           AgentRef agent,
+                           std::vector<bool>& results) const
+        {
+            agent.agent().allowed_batch(paths, results);
+        }
+
+        /**
+         * The bytes of memory used by the robots.txt, including its agents, their
+         * directives and its sitemaps. Directives shared with other Robots through a
+         * RulePool are counted in full by each.
+         */
+        size_t memory_usage() const;
+
         std::string str() const;
 
+        /**
+         * Serialize to a position-independent binary snapshot, which can be queried
+         * in place with a Snapshot.
+         */
+        std::string serialize() const;
+
         /**
          * Return the robots.txt URL corresponding to the provided URL.
          */
         static std::string robotsUrl(const std::string& url);
 
     private:
-        static void strip(std::string& string);
+        friend class RobotsParser;
 
+        /**
+         * A range of characters within the content being parsed.
+         */
+        typedef std::pair<const char*, const char*> range_t;
+
+        /**
+         * The state of a parse between lines.
+         */
+        struct State
+        {
+            explicit State(const Options& options);
+
+            // The first name of the current group, and the names that follow it
+            std::string agent_name;
+            std::vector<std::string> group;
+            // The number of names sharing each agent
+            std::vector<size_t> shares;
+            bool last_agent;
+            // The index of the current group's agent, or npos if it is skipped
+            size_t current;
+            std::string buffer;
+            // The lowercased names of the agents to build, if not all of them
+            std::unordered_set<std::string> wanted;
+            // The names of the skipped agents so far, whether the current group's
+            // skipped first name was among them, and a skipped agent whose rules
+            // turn out to be shared with a wanted one
+            std::unordered_set<std::string> skipped;
+            bool inherited;
+            std::string needed;
+        };
+
+        /**
+         * The rules of a lazily parsed robots.txt that have yet to be parsed.
+         */
+        struct Lazy
+        {
+            explicit Lazy(const Options& options)
+                : content(), spans(), mutex(), parsed(), pool(options.pool)
+                , stats(options.stats), minimize(options.minimize) {}
+
+            /**
+             * Keep the rule line with the key and value for the agent.
+             */
+            void defer(size_t agent, const range_t& key, const range_t& value);
+
+            // The rule lines of all agents, and the ranges of it for each agent
+            std::string content;
+            std::vector<std::vector<std::pair<size_t, size_t>>> spans;
+            // Held while parsing the rules of any agent
+            std::mutex mutex;
+            // Set once the rules of each agent have been parsed and published
+            std::unique_ptr<std::atomic<bool>[]> parsed;
+            // The options agents are finished with once parsed
+            RulePool* pool;
+            bool stats;
+            bool minimize;
+        };
+
+        /**
+         * The index of the agent of a skipped group.
+         */
+        static const size_t npos;
+
+        /**
+         * Create a robots.txt with no rules, for content of about the given length.
+         */
+        Robots(const Options& options, const std::string& base_url, size_t length);
+
+        /**
+         * Apply the line with the key and value.
+         */
+        void line(State& state, const range_t& key, const range_t& value);
+
+        /**
+         * Start a group of rules for the agent with the lowercased name.
+         */
+        void start(State& state, const std::string& name);
+
+        /**
+         * Give the rest of the current group the group's agent.
+         */
+        void share(State& state);
+
+        /**
+         * Finish parsing once all lines have been applied.
+         */
+        void finish(State& state, const Options& options);
+
+        /**
+         * Apply the rule line with the key and value to the agent.
+         */
+        static void rule(Agent& agent, const range_t& key, const std::string& value);
+
+        /**
+         * Swap every member with rhs.
+         */
+        void swap(Robots& rhs);
+
+        /**
+         * Parse the deferred rules of the agent with the index, if they have yet to
+         * be. This is safe to call from many threads at once.
+         */
+        void materialize(size_t index) const;
+
+        /**
+         * Parse the deferred rules of the agent with the index, and finish it as the
+         * options say. The lazy mutex must be held.
+         */
+        void parse(size_t index) const;
+
+        /**
+         * Parse the deferred rules of every agent.
+         */
+        void materialize() const;
+
+        /**
+         * Advance cursor past the next line that has a key and value, pointing key
+         * and value at them with comments and surrounding whitespace stripped.
+         * Return false when there are no lines left.
+         */
         static bool getpair(
-            std::istringstream& stream, std::string& key, std::string& value);
+            const char*& cursor, const char* end, range_t& key, range_t& value);
 
+        std::shared_ptr<Arena> arena_;
         std::string host_;
-        agent_map_t agents_;
+        /**
+         * The distinct agents, and the index of the agent for each name. The names
+         * in a group of User-agent lines all share the group's agent.
+         */
+        // Agents are only modified after parsing to materialize them, under lock
+        mutable agents_t agents_;
+        names_t names_;
         sitemaps_t sitemaps_;
-        Agent& default_;
+        size_t default_;
+        // Set only when parsing lazily
+        std::unique_ptr<Lazy> lazy_;
     };
 }
 
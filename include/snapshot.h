@@ -0,0 +1,127 @@
+#ifndef SNAPSHOT_CPP_H
+#define SNAPSHOT_CPP_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "agent.h"
+
+namespace Rep
+{
+
+    /**
+     * A read-only view of a serialized Robots (see Robots::serialize), queried in
+     * place without being deserialized. The bytes must outlive the snapshot.
+     *
+     * The format is position-independent: all integers are little-endian uint32s and
+     * all offsets are relative to the start of the snapshot. It is laid out as:
+     *
+     *   header      magic "REPS", version, size, host offset and length, index of the
+     *               default agent, then the count and offset of each table below
+     *   agents      name offset and length, first directive, directive count, and
+     *               crawl-delay (as float bits), sorted by name
+     *   directives  expression offset and length, priority and whether it allows,
+     *               in priority order within each agent
+     *   sitemaps    offset and length
+     *   strings     the bytes referenced by the tables above
+     */
+    class Snapshot
+    {
+    public:
+        /* The magic bytes that start every snapshot. */
+        static const char magic[4];
+
+        /* The current version of the format. */
+        static const uint32_t version;
+
+        /* The sizes of the header and of the records in each table. */
+        static const size_t header_size;
+        static const size_t agent_size;
+        static const size_t directive_size;
+        static const size_t sitemap_size;
+
+        /**
+         * View the snapshot at the start of data. Throws std::invalid_argument if
+         * it is not a valid snapshot of the current version.
+         */
+        Snapshot(const char* data, size_t size);
+
+        /**
+         * The size of the snapshot. Snapshots may be concatenated, in which case the
+         * next one starts at this offset.
+         */
+        size_t size() const { return size_; }
+
+        /**
+         * Return true if agent is allowed to fetch the URL (either a full URL or a
+         * path).
+         */
+        bool allowed(const std::string& path, const std::string& name) const;
+
+        /**
+         * Return the crawl-delay for the agent.
+         */
+        Agent::delay_t delay(const std::string& name) const;
+
+        /**
+         * Return a copy of the sitemaps.
+         */
+        std::vector<std::string> sitemaps() const;
+
+    private:
+        const char* data_;
+        size_t size_;
+        std::string host_;
+        size_t default_;
+        size_t agent_count_;
+        size_t agents_;
+        size_t directive_count_;
+        size_t directives_;
+        size_t sitemap_count_;
+        size_t sitemaps_;
+
+        /**
+         * Read the uint32 at offset.
+         */
+        uint32_t word(size_t offset) const;
+
+        /**
+         * Return the offset of the record for the agent with the given name.
+         */
+        size_t agent(const std::string& name) const;
+
+        /**
+         * Throw unless the string at offset and length lies within the snapshot.
+         */
+        void check(size_t offset, size_t length) const;
+    };
+
+    /**
+     * A read-only memory mapping of a whole file.
+     */
+    class MappedFile
+    {
+    public:
+        /**
+         * Map the file. Throws std::system_error on failure.
+         */
+        explicit MappedFile(const std::string& path);
+
+        MappedFile(const MappedFile& rhs) = delete;
+        MappedFile& operator=(const MappedFile& rhs) = delete;
+
+        ~MappedFile();
+
+        const char* data() const { return data_; }
+
+        size_t size() const { return size_; }
+
+    private:
+        const char* data_;
+        size_t size_;
+    };
+
+}
+
+#endif
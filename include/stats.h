@@ -0,0 +1,128 @@
+#ifndef STATS_CPP_H
+#define STATS_CPP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+namespace Rep
+{
+
+    /**
+     * Counters for the checks made against one agent: how they were decided, how
+     * often each directive won, and a histogram of how long they took. Every update
+     * is a relaxed atomic increment, so checks on many threads may record into the
+     * same Stats without locking.
+     *
+     * Agents only record checks when the library is built with REP_STATS defined;
+     * otherwise the hooks are compiled out entirely.
+     */
+    class Stats
+    {
+    public:
+        typedef std::chrono::steady_clock clock_type;
+
+        /**
+         * How a check was decided.
+         */
+        enum class Outcome
+        {
+            // A directive matched, and allowed or disallowed the path
+            allowed,
+            disallowed,
+            // No directive matched, so the path was allowed
+            fallback,
+            // The path was /robots.txt, which is always allowed
+            robots
+        };
+
+        /**
+         * The number of latency buckets. Bucket i counts the checks that took
+         * [2^i, 2^(i + 1)) nanoseconds, with the first and last buckets open-ended.
+         */
+        static const size_t buckets = 40;
+
+        /**
+         * Create stats for an agent with the given number of directives.
+         */
+        explicit Stats(size_t directives);
+
+        Stats(const Stats& rhs) = delete;
+        Stats& operator=(const Stats& rhs) = delete;
+
+        /**
+         * Record a check, which the directive with the given index decided if the
+         * outcome is allowed or disallowed.
+         */
+        void record(Outcome outcome, size_t directive, clock_type::duration elapsed);
+
+        /**
+         * The number of checks made.
+         */
+        uint64_t checks() const;
+
+        /**
+         * The number of checks that allowed their path, including fallbacks and
+         * /robots.txt short-circuits.
+         */
+        uint64_t allows() const;
+
+        /**
+         * The number of checks that disallowed their path.
+         */
+        uint64_t disallows() const;
+
+        /**
+         * The number of checks allowed because no directive matched.
+         */
+        uint64_t fallbacks() const;
+
+        /**
+         * The number of checks of /robots.txt itself.
+         */
+        uint64_t robots() const;
+
+        /**
+         * The number of checks decided by the directive with the given index.
+         */
+        uint64_t hits(size_t directive) const;
+
+        /**
+         * The number of checks in the given latency bucket.
+         */
+        uint64_t latency(size_t bucket) const;
+
+        /**
+         * An upper bound, in nanoseconds, on the latency of the given fraction of
+         * the checks, from the histogram.
+         */
+        uint64_t percentile(double fraction) const;
+
+        /**
+         * The number of directives hits are counted for.
+         */
+        size_t directives() const { return directives_; }
+
+    private:
+        typedef std::atomic<uint64_t> counter_t;
+
+        static uint64_t load(const counter_t& counter)
+        {
+            return counter.load(std::memory_order_relaxed);
+        }
+
+        static void increment(counter_t& counter)
+        {
+            counter.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        counter_t outcomes_[4];
+        counter_t latencies_[buckets];
+        size_t directives_;
+        std::unique_ptr<counter_t[]> hits_;
+    };
+
+}
+
+#endif
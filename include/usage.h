@@ -0,0 +1,50 @@
+#ifndef USAGE_CPP_H
+#define USAGE_CPP_H
+
+#include <cstddef>
+
+namespace Rep
+{
+
+    /**
+     * Estimates of the memory held by standard containers, beyond the size of the
+     * containers themselves, for accounting for the memory used by parsed objects.
+     */
+    namespace Usage
+    {
+        /**
+         * The bytes a string has allocated, or 0 if it is short enough to be stored
+         * inline.
+         */
+        template <typename String>
+        size_t string(const String& str)
+        {
+            size_t capacity = str.capacity();
+            return capacity > String(str.get_allocator()).capacity() ? capacity + 1 : 0;
+        }
+
+        /**
+         * The bytes a vector has allocated, not counting what its elements hold.
+         */
+        template <typename Vector>
+        size_t vector(const Vector& vec)
+        {
+            return vec.capacity() * sizeof(typename Vector::value_type);
+        }
+
+        /**
+         * The bytes a hash table has allocated for its buckets and nodes, not counting
+         * what its values hold. Each node is assumed to hold a next pointer and a
+         * cached hash alongside its value.
+         */
+        template <typename Table>
+        size_t table(const Table& table)
+        {
+            return table.bucket_count() * sizeof(void*) +
+                table.size() * (sizeof(typename Table::value_type) + 2 * sizeof(void*));
+        }
+    }
+
+}
+
+#endif
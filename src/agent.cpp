@@ -1,11 +1,17 @@
 #include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
 #include "url.h"
 
 #include "agent.h"
+#include "automaton.h"
+#include "buckets.h"
 #include "directive.h"
+#include "escape.h"
+#include "literal.h"
+#include "usage.h"
 
 namespace
 {
@@ -20,37 +26,151 @@ namespace
                        [chr](const char c) {return c != chr;});
         return std::string(itr, str.end());
     }
-}
 
-namespace Rep
-{
-    Agent& Agent::allow(const std::string& query)
+    /**
+     * Return the escaped path of a rule that is known not to be for another host.
+     */
+    std::string escape_rule(const std::string& rule)
     {
-        Url::Url url(query);
-        // ignore directives for external URLs
-        if (is_external(url))
+        std::string path;
+        if (!Rep::Escape::path(rule.data(), rule.data() + rule.size(), path))
         {
-            return *this;
+            Url::Url url(rule);
+            path = escape_url(url);
         }
-        // leading wildcard?
-        if (query.front() == '*')
+        return path;
+    }
+
+    /**
+     * Return false if no path can match both directives, which is so if neither of
+     * their leads starts with the other.
+     */
+    bool overlaps(const Rep::Directive& lhs, const Rep::Directive& rhs)
+    {
+        return Rep::Literal::equal(lhs.expression().data(), rhs.expression().data(),
+                                   std::min(lhs.lead(), rhs.lead()));
+    }
+
+    /**
+     * Return true if other is known to match every path that the directive matches.
+     */
+    bool covers(const Rep::Directive& other, const Rep::Directive& directive)
+    {
+        typedef Rep::Directive::Kind Kind;
+        const auto& expression = directive.expression();
+        if (other.expression() == expression)
+        {
+            return true;
+        }
+
+        // A plain prefix matches every path that starts with it, so it matches
+        // everything the directive does if it starts the directive's lead
+        if (other.kind() == Kind::prefix)
+        {
+            return directive.lead() >= other.expression().size() &&
+                Rep::Literal::equal(other.expression().data(), expression.data(),
+                                    other.expression().size());
+        }
+
+        // A literal matches only itself if anchored, and otherwise every path that
+        // starts with it, which an unanchored expression matches if it matches the
+        // literal itself
+        if (directive.kind() == Kind::exact)
         {
-            Url::Url trimmed(trim_front(query, '*'));
-            directives_.push_back(Directive(escape_url(trimmed), true));
+            return other.match(expression.data(), directive.lead());
         }
-        directives_.push_back(Directive(escape_url(url), true));
-        sorted_ = false;
+        return directive.kind() == Kind::prefix &&
+            other.expression().find('$') == Rep::Directive::string_t::npos &&
+            other.match(expression.data(), expression.size());
+    }
+}
+
+namespace Rep
+{
+    Agent::Agent(const std::string& host, Arena* arena) :
+        directives_(clone(directives_t(ArenaAllocator<Directive>(arena)), arena)),
+        delay_(-1.0), sorted_(true), host_(host), compiled_(), buckets_(), stats_()
+    {
+    }
+
+    Agent::Agent(const Agent& rhs) : Agent(rhs, nullptr)
+    {
+    }
+
+    Agent::Agent(const Agent& rhs, Arena* arena) :
+        directives_(rhs.arena() == arena ? rhs.directives_
+                                         : clone(*rhs.directives_, arena)),
+        delay_(rhs.delay_), sorted_(rhs.sorted_), host_(rhs.host_),
+        compiled_(rhs.compiled_),
+        buckets_(rhs.buckets_), stats_(rhs.stats_)
+    {
+    }
+
+    Agent::Agent(Agent&& rhs) noexcept :
+        directives_(rhs.directives_), delay_(rhs.delay_), sorted_(rhs.sorted_),
+        host_(std::move(rhs.host_)), compiled_(std::move(rhs.compiled_)),
+        buckets_(std::move(rhs.buckets_)), stats_(std::move(rhs.stats_))
+    {
+    }
+
+    Agent& Agent::operator=(Agent&& rhs) noexcept
+    {
+        directives_ = rhs.directives_;
+        delay_ = rhs.delay_;
+        sorted_ = rhs.sorted_;
+        host_ = std::move(rhs.host_);
+        compiled_ = std::move(rhs.compiled_);
+        buckets_ = std::move(rhs.buckets_);
+        stats_ = std::move(rhs.stats_);
+        return *this;
+    }
+
+    Agent& Agent::operator=(const Agent& rhs)
+    {
+        directives_ = rhs.arena() ? clone(*rhs.directives_, nullptr) : rhs.directives_;
+        delay_ = rhs.delay_;
+        sorted_ = rhs.sorted_;
+        host_ = rhs.host_;
+        compiled_ = rhs.compiled_;
+        buckets_ = rhs.buckets_;
+        stats_ = rhs.stats_;
         return *this;
     }
 
+    std::shared_ptr<Agent::directives_t> Agent::clone(
+        const directives_t& directives, Arena* arena)
+    {
+        auto result = std::allocate_shared<directives_t>(
+            ArenaAllocator<directives_t>(arena), ArenaAllocator<Directive>(arena));
+        result->reserve(directives.size());
+        for (const auto& directive : directives)
+        {
+            result->emplace_back(directive, arena);
+        }
+        return result;
+    }
+
+    Agent& Agent::allow(const std::string& query)
+    {
+        return rule(query, true);
+    }
+
     Agent& Agent::disallow(const std::string& query)
     {
         if (query.empty())
         {
             // Special case: "Disallow:" means "Allow: /"
-            directives_.push_back(Directive(query, true));
+            add(Directive(query, true, arena()));
+            return *this;
         }
-        else
+        return rule(query, false);
+    }
+
+    Agent& Agent::rule(const std::string& query, bool allowed)
+    {
+        // Only rules that might be absolute URLs are parsed as URLs
+        std::string path;
+        if (!Escape::path(query.data(), query.data() + query.size(), path))
         {
             Url::Url url(query);
             // ignore directives for external URLs
@@ -58,53 +178,344 @@ namespace Rep
             {
                 return *this;
             }
-            // leading wildcard?
-            if (query.front() == '*')
-            {
-                Url::Url trimmed(trim_front(query, '*'));
-                directives_.push_back(Directive(escape_url(trimmed), false));
-            }
-            directives_.push_back(Directive(escape_url(url), false));
+            path = escape_url(url);
+        }
+        // leading wildcard?
+        if (!query.empty() && query.front() == '*')
+        {
+            add(Directive(escape_rule(trim_front(query, '*')), allowed, arena()));
         }
-        sorted_ = false;
+        add(Directive(path, allowed, arena()));
         return *this;
     }
 
-    const std::vector<Directive>& Agent::directives() const
+    void Agent::add(Directive&& directive)
     {
-        if (!sorted_)
+        if (directives_.use_count() != 1)
         {
-            std::sort(directives_.begin(), directives_.end(),
-                [](const Directive& a, const Directive& b) {
-                    return b.priority() < a.priority();
+            directives_ = clone(*directives_, arena());
+        }
+        if (sorted_)
+        {
+            auto position = std::upper_bound(directives_->begin(), directives_->end(),
+                directive.priority(),
+                [](Directive::priority_t priority, const Directive& other) {
+                    return other.priority() < priority;
                 });
-            sorted_ = true;
+            directives_->insert(position, std::move(directive));
+        }
+        else
+        {
+            directives_->push_back(std::move(directive));
+        }
+        compiled_.reset();
+        buckets_.reset();
+        stats_.reset();
+    }
+
+    void Agent::sort()
+    {
+        sorted_ = true;
+        auto higher = [](const Directive& lhs, const Directive& rhs) {
+            return rhs.priority() < lhs.priority();
+        };
+        if (std::is_sorted(directives_->begin(), directives_->end(), higher))
+        {
+            return;
+        }
+        // Directives are only shared unsorted between agents that are all yet to be
+        // sorted, so they are sorted in place for all of them. Stable, so that those
+        // of the same priority keep the order they were added in.
+        std::stable_sort(directives_->begin(), directives_->end(), higher);
+    }
+
+    Agent& Agent::minimize()
+    {
+        typedef Directive::priority_t priority_t;
+        const directives_t& d = *directives_;
+
+        // The indices of the disallows and the allows, in priority order
+        std::vector<size_t> verdicts[2];
+        std::vector<size_t> leads(d.size());
+        for (size_t index = 0; index < d.size(); ++index)
+        {
+            verdicts[d[index].allowed()].push_back(index);
+            leads[index] = d[index].lead();
+        }
+        auto starts = [&d, &leads](size_t prefix, size_t index) {
+            return leads[prefix] <= leads[index] && Literal::equal(
+                d[prefix].expression().data(), d[index].expression().data(),
+                leads[prefix]);
+        };
+
+        std::vector<bool> removed(d.size(), false);
+        auto redundant = [&](size_t index, const std::vector<size_t>& candidates) {
+            const Directive& directive = d[index];
+            bool allowed = directive.allowed();
+            priority_t priority = directive.priority();
+
+            // The directive can be removed in favor of another that matches every
+            // path it does, if that one wins instead of it, ties with it in a way
+            // that decides the same, or decides the same in its place. That last is
+            // only sure if no rule to the contrary that may match the same paths has
+            // a priority between the two, so the highest such priority is found the
+            // first time it is needed.
+            const auto& opposite = verdicts[!allowed];
+            auto blocker = opposite.end();
+            bool found = false;
+            for (size_t candidate : candidates)
+            {
+                const Directive& other = d[candidate];
+                if (candidate == index || removed[candidate] ||
+                    !covers(other, directive))
+                {
+                    continue;
+                }
+                if (other.priority() >= priority)
+                {
+                    if (other.priority() > priority || other.allowed() == allowed ||
+                        other.allowed())
+                    {
+                        return true;
+                    }
+                    continue;
+                }
+                if (other.allowed() != allowed)
+                {
+                    continue;
+                }
+                if (!found)
+                {
+                    blocker = std::lower_bound(opposite.begin(), opposite.end(),
+                        priority, [&d](size_t rule, priority_t priority) {
+                            return d[rule].priority() > priority;
+                        });
+                    while (blocker != opposite.end() && !overlaps(d[*blocker], directive))
+                    {
+                        ++blocker;
+                    }
+                    found = true;
+                }
+                if (blocker == opposite.end() || other.priority() > d[*blocker].priority())
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        // Any directive that matches every path another does has a lead that starts
+        // the other's lead. So the directives are visited in order of their leads,
+        // keeping a stack of those whose leads start the current one, which are the
+        // only candidates to stand in for it.
+        std::vector<size_t> order(d.size());
+        for (size_t index = 0; index < d.size(); ++index)
+        {
+            order[index] = index;
+        }
+        std::stable_sort(order.begin(), order.end(),
+            [&d, &leads](size_t lhs, size_t rhs) {
+                int order = std::memcmp(d[lhs].expression().data(),
+                    d[rhs].expression().data(), std::min(leads[lhs], leads[rhs]));
+                return order < 0 || (order == 0 && leads[lhs] < leads[rhs]);
+            });
+
+        size_t remaining = d.size();
+        std::vector<size_t> stack;
+        for (auto begin = order.begin(); begin != order.end();)
+        {
+            // Those with the same lead are candidates for each other
+            auto end = begin + 1;
+            while (end != order.end() && leads[*end] == leads[*begin] &&
+                   starts(*begin, *end))
+            {
+                ++end;
+            }
+            while (!stack.empty() && !starts(stack.back(), *begin))
+            {
+                stack.pop_back();
+            }
+            stack.insert(stack.end(), begin, end);
+
+            for (; begin != end; ++begin)
+            {
+                if (redundant(*begin, stack))
+                {
+                    removed[*begin] = true;
+                    --remaining;
+                }
+            }
+        }
+
+        if (remaining == d.size())
+        {
+            return *this;
         }
-        return directives_;
+        auto result = std::allocate_shared<directives_t>(
+            ArenaAllocator<directives_t>(arena()), ArenaAllocator<Directive>(arena()));
+        result->reserve(remaining);
+        for (size_t index = 0; index < d.size(); ++index)
+        {
+            if (!removed[index])
+            {
+                result->emplace_back(d[index], arena());
+            }
+        }
+        directives_ = result;
+        compiled_.reset();
+        buckets_.reset();
+        stats_.reset();
+        return *this;
+    }
+
+    Agent& Agent::compile()
+    {
+        compiled_ = std::make_shared<const Automaton>(*directives_);
+        return *this;
+    }
+
+    Agent& Agent::bucket()
+    {
+        buckets_ = std::make_shared<const Buckets>(*directives_);
+        return *this;
+    }
+
+    Agent& Agent::instrument()
+    {
+#ifdef REP_STATS
+        stats_ = std::make_shared<Stats>(directives_->size());
+#endif
+        return *this;
     }
 
     bool Agent::allowed(const std::string& query) const
     {
+        std::string path;
+        return normalize(query, path) && check(path.data(), path.size());
+    }
+
+    bool Agent::allowed_path(const char* path, size_t length) const
+    {
+        return check(path, length);
+    }
+
+    void Agent::allowed_batch(
+        const std::vector<std::string>& queries, std::vector<bool>& results) const
+    {
+        results.resize(queries.size());
+        std::string path;
+        for (size_t index = 0; index < queries.size(); ++index)
+        {
+            results[index] =
+                normalize(queries[index], path) && check(path.data(), path.size());
+        }
+    }
+
+    bool Agent::normalize(const std::string& query, std::string& path) const
+    {
+        // Only queries that might be absolute URLs are parsed as URLs
+        if (Escape::path(query.data(), query.data() + query.size(), path))
+        {
+            return true;
+        }
         Url::Url url(query);
         if (is_external(url))
         {
             return false;
         }
-        std::string path(escape_url(url));
+        path = escape_url(url);
+        return true;
+    }
+
+    bool Agent::check(const char* path, size_t length) const
+    {
+        static const char robots[] = "/robots.txt";
+        bool is_robots =
+            length == sizeof(robots) - 1 && std::memcmp(path, robots, length) == 0;
+
+#ifdef REP_STATS
+        if (stats_)
+        {
+            Stats::clock_type::time_point start = Stats::clock_type::now();
+            size_t index = is_robots ? Automaton::npos : match(path, length);
+            Stats::Outcome outcome = Stats::Outcome::robots;
+            if (!is_robots)
+            {
+                outcome = index == Automaton::npos ? Stats::Outcome::fallback
+                    : (*directives_)[index].allowed() ? Stats::Outcome::allowed
+                    : Stats::Outcome::disallowed;
+            }
+            stats_->record(outcome, index, Stats::clock_type::now() - start);
+            return outcome != Stats::Outcome::disallowed;
+        }
+#endif
 
-        if (path.compare("/robots.txt") == 0)
+        if (is_robots)
         {
             return true;
         }
+        size_t index = match(path, length);
+        return index == Automaton::npos || (*directives_)[index].allowed();
+    }
+
+    size_t Agent::match(const char* path, size_t length) const
+    {
+        if (compiled_)
+        {
+            return compiled_->match(path, length);
+        }
+        if (buckets_)
+        {
+            return buckets_->match(*directives_, path, length);
+        }
 
-        for (const auto& directive : directives())
+        const auto& d = *directives_;
+        for (auto it = d.begin(); it != d.end(); ++it)
         {
-            if (directive.match(path))
+            if (it->match(path, length))
             {
-                return directive.allowed();
+                if (it->allowed())
+                {
+                    return it - d.begin();
+                }
+
+                // An allow with the same priority wins the tie
+                for (auto other = it + 1;
+                     other != d.end() && other->priority() == it->priority(); ++other)
+                {
+                    if (other->allowed() && other->match(path, length))
+                    {
+                        return other - d.begin();
+                    }
+                }
+                return it - d.begin();
             }
         }
-        return true;
+        return Automaton::npos;
+    }
+
+    size_t Agent::memory_usage() const
+    {
+        size_t result = sizeof(Agent) + Usage::string(host_);
+        if (!arena())
+        {
+            // The container shares its allocation with the reference counts
+            result += sizeof(directives_t) + 2 * sizeof(long) +
+                (directives_->capacity() - directives_->size()) * sizeof(Directive);
+            for (const auto& directive : *directives_)
+            {
+                result += directive.memory_usage();
+            }
+        }
+        if (compiled_)
+        {
+            result += compiled_->memory_usage();
+        }
+        if (buckets_)
+        {
+            result += buckets_->memory_usage();
+        }
+        return result;
     }
 
     std::string Agent::str() const
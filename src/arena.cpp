@@ -0,0 +1,35 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "arena.h"
+
+namespace Rep
+{
+    Arena::Arena(size_t block_size)
+        : blocks_(), current_(nullptr), remaining_(0)
+        , block_size_(std::max(block_size, static_cast<size_t>(64)))
+        , capacity_(0)
+    {
+    }
+
+    void* Arena::allocate(size_t size, size_t alignment)
+    {
+        size_t padding = -reinterpret_cast<uintptr_t>(current_) & (alignment - 1);
+        if (!current_ || padding + size > remaining_)
+        {
+            // Start a new block big enough for this, and grow the next one
+            size_t block = std::max(block_size_, size + alignment);
+            blocks_.emplace_back(new char[block]);
+            current_ = blocks_.back().get();
+            remaining_ = block;
+            capacity_ += block;
+            block_size_ *= 2;
+            padding = -reinterpret_cast<uintptr_t>(current_) & (alignment - 1);
+        }
+
+        char* result = current_ + padding;
+        current_ = result + size;
+        remaining_ -= padding + size;
+        return result;
+    }
+}
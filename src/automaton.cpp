@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <cstdint>
+#include <map>
+
+#include "automaton.h"
+#include "usage.h"
+
+namespace
+{
+    /**
+     * Per-thread buffers for simulating wildcard automata, so that a match does not
+     * allocate once the buffers have grown to size.
+     */
+    struct Scratch
+    {
+        Scratch() : current(), upcoming(), seen(), step(0) {}
+
+        std::vector<size_t> current;
+        std::vector<size_t> upcoming;
+        std::vector<uint64_t> seen;
+        uint64_t step;
+    };
+}
+
+namespace Rep
+{
+    const size_t Automaton::npos = static_cast<size_t>(-1);
+
+    Automaton::Automaton(const Agent::directives_t& directives)
+        : rules_(), nodes_(1), edges_(), wildcards_(false)
+    {
+        // Children are collected in ordered maps while building, and then flattened
+        // into sorted runs of edges_.
+        std::vector<std::map<char, size_t>> children(1);
+        for (size_t index = 0; index < directives.size(); ++index)
+        {
+            const Directive& directive = directives[index];
+            rules_.push_back(rule_t(directive.priority(), directive.allowed()));
+
+            size_t node = 0;
+            bool anchored = false;
+            for (auto chr : directive.expression())
+            {
+                if (chr == '$')
+                {
+                    // Anything after a '$' can never be matched
+                    anchored = true;
+                    break;
+                }
+                else if (chr == '*')
+                {
+                    wildcards_ = true;
+                    if (!nodes_[node].star)
+                    {
+                        nodes_[node].star = nodes_.size();
+                        nodes_.push_back(Node());
+                        nodes_.back().loop = true;
+                        children.push_back(std::map<char, size_t>());
+                    }
+                    node = nodes_[node].star;
+                }
+                else
+                {
+                    auto it = children[node].find(chr);
+                    if (it == children[node].end())
+                    {
+                        size_t child = nodes_.size();
+                        children[node][chr] = child;
+                        nodes_.push_back(Node());
+                        children.push_back(std::map<char, size_t>());
+                        node = child;
+                    }
+                    else
+                    {
+                        node = it->second;
+                    }
+                }
+            }
+
+            size_t& terminal = anchored ? nodes_[node].anchored : nodes_[node].prefix;
+            terminal = better(terminal, index);
+        }
+
+        for (size_t node = 0; node < nodes_.size(); ++node)
+        {
+            nodes_[node].first = edges_.size();
+            edges_.insert(edges_.end(), children[node].begin(), children[node].end());
+            nodes_[node].last = edges_.size();
+        }
+    }
+
+    size_t Automaton::memory_usage() const
+    {
+        return sizeof(Automaton) + Usage::vector(rules_) + Usage::vector(nodes_) +
+            Usage::vector(edges_);
+    }
+
+    size_t Automaton::match(const std::string& path) const
+    {
+        return match(path.data(), path.size());
+    }
+
+    size_t Automaton::match(const char* path, size_t length) const
+    {
+        const char* end = path + length;
+        size_t best = nodes_[0].prefix;
+        if (!wildcards_)
+        {
+            // Only literal rules, so this is just a walk down the trie
+            size_t node = 0;
+            for (const char* chr = path; chr != end; ++chr)
+            {
+                node = next(node, *chr);
+                if (!node)
+                {
+                    return best;
+                }
+                best = better(best, nodes_[node].prefix);
+            }
+            return better(best, nodes_[node].anchored);
+        }
+
+        thread_local Scratch scratch;
+        if (scratch.seen.size() < nodes_.size())
+        {
+            scratch.seen.resize(nodes_.size(), 0);
+        }
+
+        // Make a node active for the next step, along with the '*' that follows it,
+        // since '*' may match nothing at all.
+        auto visit = [this, &best](size_t node) {
+            do
+            {
+                if (scratch.seen[node] == scratch.step)
+                {
+                    return;
+                }
+                scratch.seen[node] = scratch.step;
+                scratch.upcoming.push_back(node);
+                best = better(best, nodes_[node].prefix);
+                node = nodes_[node].star;
+            } while (node);
+        };
+
+        ++scratch.step;
+        scratch.upcoming.clear();
+        visit(0);
+        scratch.current.swap(scratch.upcoming);
+        for (const char* chr = path; chr != end; ++chr)
+        {
+            ++scratch.step;
+            scratch.upcoming.clear();
+            for (auto node : scratch.current)
+            {
+                if (nodes_[node].loop)
+                {
+                    visit(node);
+                }
+                size_t child = next(node, *chr);
+                if (child)
+                {
+                    visit(child);
+                }
+            }
+            scratch.current.swap(scratch.upcoming);
+            if (scratch.current.empty())
+            {
+                return best;
+            }
+        }
+
+        for (auto node : scratch.current)
+        {
+            best = better(best, nodes_[node].anchored);
+        }
+        return best;
+    }
+
+    size_t Automaton::next(size_t node, char chr) const
+    {
+        auto begin = edges_.begin() + nodes_[node].first;
+        auto end = edges_.begin() + nodes_[node].last;
+        auto it = std::lower_bound(begin, end, edge_t(chr, 0));
+        if (it != end && it->first == chr)
+        {
+            return it->second;
+        }
+        return 0;
+    }
+
+    size_t Automaton::better(size_t current, size_t candidate) const
+    {
+        if (current == npos)
+        {
+            return candidate;
+        }
+        else if (candidate == npos)
+        {
+            return current;
+        }
+
+        const rule_t& incumbent = rules_[current];
+        const rule_t& challenger = rules_[candidate];
+        if (challenger.first != incumbent.first)
+        {
+            return challenger.first > incumbent.first ? candidate : current;
+        }
+        else if (challenger.second != incumbent.second)
+        {
+            // Allow wins a tie
+            return challenger.second ? candidate : current;
+        }
+        return std::min(current, candidate);
+    }
+}
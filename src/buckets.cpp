@@ -0,0 +1,109 @@
+#include <algorithm>
+
+#include "automaton.h"
+#include "buckets.h"
+#include "usage.h"
+
+namespace
+{
+    const uint64_t basis = 14695981039346656037ull;
+}
+
+namespace Rep
+{
+    const size_t Buckets::minimum;
+
+    Buckets::Buckets(const Agent::directives_t& directives)
+        : buckets_(), lengths_()
+    {
+        for (size_t index = 0; index < directives.size(); ++index)
+        {
+            const auto& expression = directives[index].expression();
+            size_t length = key(directives[index]);
+            uint64_t hash = basis;
+            for (size_t position = 0; position < length; ++position)
+            {
+                hash = mix(hash, expression[position]);
+            }
+            buckets_[hash].push_back(index);
+            lengths_.push_back(length);
+        }
+
+        std::sort(lengths_.begin(), lengths_.end());
+        lengths_.erase(std::unique(lengths_.begin(), lengths_.end()), lengths_.end());
+    }
+
+    size_t Buckets::key(const Directive& directive)
+    {
+        // The lead, up to and including the '/' that ends the first segment
+        const auto& expression = directive.expression();
+        size_t lead = directive.lead();
+        if (lead == 0 || expression[0] != '/')
+        {
+            return lead;
+        }
+        size_t slash = expression.find('/', 1);
+        return slash < lead ? slash + 1 : lead;
+    }
+
+    size_t Buckets::match(const Agent::directives_t& directives,
+                          const char* path, size_t length) const
+    {
+        size_t best = Automaton::npos;
+        uint64_t hash = basis;
+        size_t hashed = 0;
+        for (size_t key : lengths_)
+        {
+            if (key > length)
+            {
+                break;
+            }
+            for (; hashed < key; ++hashed)
+            {
+                hash = mix(hash, path[hashed]);
+            }
+            auto bucket = buckets_.find(hash);
+            if (bucket == buckets_.end())
+            {
+                continue;
+            }
+
+            for (size_t index : bucket->second)
+            {
+                const Directive& directive = directives[index];
+                if (best != Automaton::npos)
+                {
+                    // The rest of the bucket has no higher priority, and can only
+                    // win a tie as an allow over a disallow, or as an earlier rule
+                    const Directive& incumbent = directives[best];
+                    if (directive.priority() < incumbent.priority())
+                    {
+                        break;
+                    }
+                    if (directive.priority() == incumbent.priority() &&
+                        (directive.allowed() == incumbent.allowed() ? index > best
+                                                                    : incumbent.allowed()))
+                    {
+                        continue;
+                    }
+                }
+                if (directive.match(path, length))
+                {
+                    best = index;
+                }
+            }
+        }
+        return best;
+    }
+
+    size_t Buckets::memory_usage() const
+    {
+        size_t result = sizeof(Buckets) + Usage::table(buckets_) +
+            Usage::vector(lengths_);
+        for (const auto& bucket : buckets_)
+        {
+            result += Usage::vector(bucket.second);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "bulk.h"
+
+namespace
+{
+    /**
+     * The documents a worker has yet to parse. The owner takes batches from the
+     * front, and thieves take half of what is left from the back.
+     */
+    struct Range
+    {
+        Range() : mutex(), begin(0), end(0) {}
+
+        std::mutex mutex;
+        size_t begin;
+        size_t end;
+    };
+
+    /**
+     * Parse every document across the pool, passing each result (or null, if its
+     * base URL could not be parsed) to handle along with the index of its document.
+     */
+    void run(const std::vector<Rep::document_t>& documents,
+             const Rep::BulkOptions& options, std::vector<Rep::BulkStats>* stats,
+             const std::function<void(size_t, std::unique_ptr<Rep::Robots>&)>& handle)
+    {
+        size_t threads = options.threads;
+        if (!threads)
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = std::max(static_cast<size_t>(1), std::min(threads, documents.size()));
+        size_t batch = std::max(static_cast<size_t>(1), options.batch);
+
+        // Each worker starts with an equal, contiguous share
+        std::vector<Range> ranges(threads);
+        for (size_t index = 0; index < threads; ++index)
+        {
+            ranges[index].begin = documents.size() * index / threads;
+            ranges[index].end = documents.size() * (index + 1) / threads;
+        }
+        std::vector<Rep::BulkStats> results(threads);
+
+        auto work = [&](size_t self) {
+            auto start = std::chrono::steady_clock::now();
+            Rep::BulkStats& result = results[self];
+            while (true)
+            {
+                size_t begin = 0;
+                size_t end = 0;
+                {
+                    Range& own = ranges[self];
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    begin = own.begin;
+                    end = std::min(own.end, begin + batch);
+                    own.begin = end;
+                }
+
+                for (size_t offset = 1; begin == end && offset < threads; ++offset)
+                {
+                    Range& victim = ranges[(self + offset) % threads];
+                    std::lock_guard<std::mutex> lock(victim.mutex);
+                    size_t remaining = victim.end - victim.begin;
+                    if (remaining)
+                    {
+                        end = victim.end;
+                        begin = victim.end - (remaining + 1) / 2;
+                        victim.end = begin;
+                        ++result.steals;
+                    }
+                }
+                if (begin == end)
+                {
+                    break;
+                }
+
+                // Keep stolen work beyond the first batch where others can steal it
+                if (end - begin > batch)
+                {
+                    Range& own = ranges[self];
+                    std::lock_guard<std::mutex> lock(own.mutex);
+                    own.begin = begin + batch;
+                    own.end = end;
+                    end = begin + batch;
+                }
+
+                for (size_t index = begin; index < end; ++index)
+                {
+                    const Rep::document_t& document = documents[index];
+                    std::unique_ptr<Rep::Robots> robots;
+                    try
+                    {
+                        robots.reset(new Rep::Robots(
+                            document.second, document.first, options.robots));
+                    }
+                    catch (const std::exception&)
+                    {
+                        ++result.failures;
+                    }
+                    handle(index, robots);
+                    ++result.documents;
+                    result.bytes += document.second.size();
+                }
+            }
+            result.seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+        };
+
+        std::vector<std::thread> pool;
+        for (size_t index = 1; index < threads; ++index)
+        {
+            pool.emplace_back(work, index);
+        }
+        work(0);
+        for (auto& thread : pool)
+        {
+            thread.join();
+        }
+
+        if (stats)
+        {
+            stats->swap(results);
+        }
+    }
+}
+
+namespace Rep
+{
+    std::vector<std::unique_ptr<Robots>> parse_many(
+        const std::vector<document_t>& documents, const BulkOptions& options,
+        std::vector<BulkStats>* stats)
+    {
+        std::vector<std::unique_ptr<Robots>> result(documents.size());
+        run(documents, options, stats,
+            [&result](size_t index, std::unique_ptr<Robots>& robots) {
+                result[index] = std::move(robots);
+            });
+        return result;
+    }
+
+    std::vector<std::string> serialize_many(
+        const std::vector<document_t>& documents, const BulkOptions& options,
+        std::vector<BulkStats>* stats)
+    {
+        std::vector<std::string> result(documents.size());
+        run(documents, options, stats,
+            [&result](size_t index, std::unique_ptr<Robots>& robots) {
+                if (robots)
+                {
+                    result[index] = robots->serialize();
+                }
+            });
+        return result;
+    }
+}
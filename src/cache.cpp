@@ -0,0 +1,162 @@
+#include <functional>
+
+#include "cache.h"
+
+namespace Rep
+{
+    RobotsCache::RobotsCache(size_t budget, clock_type::duration ttl, size_t shards)
+        : budget_(budget / (shards ? shards : 1)), ttl_(ttl), shards_()
+    {
+        for (size_t index = 0; index < (shards ? shards : 1); ++index)
+        {
+            shards_.emplace_back(new Shard());
+        }
+    }
+
+    void RobotsCache::insert(const std::string& url, const std::string& content,
+                             clock_type::time_point now)
+    {
+        std::string key(Robots::robotsUrl(url));
+        auto robots = std::make_shared<const Robots>(content, key);
+        size_t size = robots->memory_usage() + key.size();
+        insert(url, std::move(robots), size, now);
+    }
+
+    void RobotsCache::insert(const std::string& url,
+                             std::shared_ptr<const Robots> robots, size_t size,
+                             clock_type::time_point now)
+    {
+        std::string key(Robots::robotsUrl(url));
+        Shard& target = shard(key);
+        std::lock_guard<std::mutex> lock(target.mutex);
+
+        size_t slot;
+        auto it = target.index.find(key);
+        if (it != target.index.end())
+        {
+            slot = it->second;
+            target.usage -= target.entries[slot].size;
+        }
+        else
+        {
+            if (target.free.empty())
+            {
+                slot = target.entries.size();
+                target.entries.emplace_back();
+            }
+            else
+            {
+                slot = target.free.back();
+                target.free.pop_back();
+            }
+            target.index.emplace(key, slot);
+        }
+
+        Entry& entry = target.entries[slot];
+        entry.key = key;
+        entry.robots = std::move(robots);
+        entry.size = size;
+        entry.expires = now + ttl_;
+        entry.referenced = true;
+        target.usage += size;
+        evict(target);
+    }
+
+    std::shared_ptr<const Robots> RobotsCache::find(
+        const std::string& url, Status& status, clock_type::time_point now)
+    {
+        std::string key(Robots::robotsUrl(url));
+        Shard& target = shard(key);
+        std::lock_guard<std::mutex> lock(target.mutex);
+        auto it = target.index.find(key);
+        if (it == target.index.end())
+        {
+            status = Status::miss;
+            return nullptr;
+        }
+
+        Entry& entry = target.entries[it->second];
+        entry.referenced = true;
+        status = now < entry.expires ? Status::hit : Status::stale;
+        return entry.robots;
+    }
+
+    RobotsCache::Result RobotsCache::allowed(
+        const std::string& url, const std::string& agent, clock_type::time_point now)
+    {
+        Result result = {Status::miss, true};
+        // The check itself happens outside of the shard's lock
+        std::shared_ptr<const Robots> robots = find(url, result.status, now);
+        if (robots)
+        {
+            result.allowed = robots->allowed(url, agent);
+        }
+        return result;
+    }
+
+    void RobotsCache::erase(const std::string& url)
+    {
+        std::string key(Robots::robotsUrl(url));
+        Shard& target = shard(key);
+        std::lock_guard<std::mutex> lock(target.mutex);
+        auto it = target.index.find(key);
+        if (it != target.index.end())
+        {
+            remove(target, it->second);
+        }
+    }
+
+    size_t RobotsCache::size() const
+    {
+        size_t result = 0;
+        for (const auto& target : shards_)
+        {
+            std::lock_guard<std::mutex> lock(target->mutex);
+            result += target->index.size();
+        }
+        return result;
+    }
+
+    size_t RobotsCache::usage() const
+    {
+        size_t result = 0;
+        for (const auto& target : shards_)
+        {
+            std::lock_guard<std::mutex> lock(target->mutex);
+            result += target->usage;
+        }
+        return result;
+    }
+
+    RobotsCache::Shard& RobotsCache::shard(const std::string& key)
+    {
+        return *shards_[std::hash<std::string>()(key) % shards_.size()];
+    }
+
+    void RobotsCache::remove(Shard& shard, size_t slot)
+    {
+        Entry& entry = shard.entries[slot];
+        shard.index.erase(entry.key);
+        shard.usage -= entry.size;
+        shard.free.push_back(slot);
+        entry = Entry();
+    }
+
+    void RobotsCache::evict(Shard& shard)
+    {
+        // An entry larger than the whole budget is still kept, on its own
+        while (shard.usage > budget_ && shard.index.size() > 1)
+        {
+            Entry& entry = shard.entries[shard.hand];
+            if (entry.referenced)
+            {
+                entry.referenced = false;
+            }
+            else if (entry.robots)
+            {
+                remove(shard, shard.hand);
+            }
+            shard.hand = (shard.hand + 1) % shard.entries.size();
+        }
+    }
+}
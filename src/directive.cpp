@@ -6,17 +6,36 @@
 #include "url.h"
 
 #include "directive.h"
+#include "literal.h"
+#include "usage.h"
 
 namespace Rep
 {
     Directive::Directive(const std::string& line, bool allowed)
-        : expression_()
+        : Directive(line, allowed, nullptr)
+    {
+    }
+
+    Directive::Directive(const Directive& rhs, Arena* arena)
+        : expression_(rhs.expression_, ArenaAllocator<char>(arena))
+        , priority_(rhs.priority_)
+        , allowed_(rhs.allowed_)
+        , kind_(rhs.kind_)
+        , star_(rhs.star_)
+    {
+    }
+
+    Directive::Directive(const std::string& line, bool allowed, Arena* arena)
+        : expression_(ArenaAllocator<char>(arena))
         , priority_(line.size())
         , allowed_(allowed)
+        , kind_(Kind::general)
+        , star_(0)
     {
         if (line.find('*') == std::string::npos)
         {
-            expression_.assign(line);
+            expression_.assign(line.data(), line.size());
+            classify();
             return;
         }
 
@@ -41,7 +60,7 @@ namespace Rep
         }
 
         // Remove trailing '*'s
-        std::string::reverse_iterator last =
+        string_t::reverse_iterator last =
             std::find_if(expression_.rbegin(), expression_.rend(),
                 [](const char c) {
                     return c != '*';
@@ -50,63 +69,146 @@ namespace Rep
 
         // Priority is the length of the expression
         priority_ = expression_.size();
+        classify();
     }
 
-    bool Directive::match(const std::string::const_iterator& e_begin,
-                          const std::string::const_iterator& e_end,
-                          const std::string::const_iterator& p_begin,
-                          const std::string::const_iterator& p_end) const
+    void Directive::classify()
     {
-        std::string::const_iterator expression_it = e_begin;
-        std::string::const_iterator path_it = p_begin;
-        while (expression_it != e_end && path_it != p_end)
+        size_t dollar = expression_.find('$');
+        size_t star = expression_.find('*');
+        size_t size = expression_.size();
+        bool anchored = size && dollar == size - 1;
+        if (dollar != string_t::npos && !anchored)
         {
-            if (*expression_it == '*')
-            {
-                // Advance and recurse
-                ++expression_it;
-                for (; path_it != p_end; ++path_it)
-                {
-                    if (match(expression_it, e_end, path_it, p_end))
-                    {
-                        return true;
-                    }
-                }
-                return false;
-            }
-            else if (*expression_it == '$')
-            {
-                // This check expects path to be fully consumed. But since one of the
-                // criteria of being in this while loop is that we've not fully consumed
-                // path, return false.
-                return false;
-            }
-            else if (*expression_it != *path_it)
+            // Anything after a '$' is never matched, so this is left to the general
+            // kernel
+            kind_ = Kind::general;
+        }
+        else if (star == string_t::npos)
+        {
+            kind_ = anchored ? Kind::exact : Kind::prefix;
+        }
+        else if (expression_.find('*', star + 1) == string_t::npos &&
+                 star <= UINT32_MAX)
+        {
+            kind_ = anchored ? Kind::suffix : Kind::infix;
+            star_ = static_cast<uint32_t>(star);
+        }
+        else
+        {
+            kind_ = Kind::general;
+        }
+    }
+
+    template <>
+    bool Directive::match<Directive::Kind::prefix>(const char* path, size_t length) const
+    {
+        size_t size = expression_.size();
+        return length >= size && Literal::equal(expression_.data(), path, size);
+    }
+
+    template <>
+    bool Directive::match<Directive::Kind::exact>(const char* path, size_t length) const
+    {
+        size_t size = expression_.size() - 1;
+        return length == size && Literal::equal(expression_.data(), path, size);
+    }
+
+    template <>
+    bool Directive::match<Directive::Kind::infix>(const char* path, size_t length) const
+    {
+        // The run after the '*' is never empty, since trailing '*'s are removed
+        const char* expression = expression_.data();
+        const char* end = path + length;
+        return length >= star_ && Literal::equal(expression, path, star_) &&
+            Literal::search(path + star_, end, expression + star_ + 1,
+                            expression_.size() - star_ - 1) != end;
+    }
+
+    template <>
+    bool Directive::match<Directive::Kind::suffix>(const char* path, size_t length) const
+    {
+        // The run between the '*' and the '$' may be empty
+        const char* expression = expression_.data();
+        size_t tail = expression_.size() - star_ - 2;
+        return length >= star_ + tail && Literal::equal(expression, path, star_) &&
+            Literal::equal(expression + star_ + 1, path + length - tail, tail);
+    }
+
+    template <>
+    bool Directive::match<Directive::Kind::general>(const char* path, size_t length) const
+    {
+        const char* expression = expression_.data();
+        return match(expression, expression + expression_.size(), path, path + length);
+    }
+
+    bool Directive::match(const char* e_begin, const char* e_end,
+                          const char* p_begin, const char* p_end)
+    {
+        // A '$' anchors the expression to the end of the path, and anything after it
+        // can never be matched
+        const char* dollar = std::find(e_begin, e_end, '$');
+        bool anchored = (dollar != e_end);
+        e_end = dollar;
+
+        // The run before the first '*' must match at the start of the path
+        const char* star = std::find(e_begin, e_end, '*');
+        size_t length = star - e_begin;
+        if (static_cast<size_t>(p_end - p_begin) < length ||
+            !Literal::equal(e_begin, p_begin, length))
+        {
+            return false;
+        }
+        p_begin += length;
+        if (star == e_end)
+        {
+            return !anchored || p_begin == p_end;
+        }
+
+        // Runs between '*'s are matched at their leftmost position
+        e_begin = star + 1;
+        star = std::find(e_begin, e_end, '*');
+        while (star != e_end)
+        {
+            const char* found = Literal::search(p_begin, p_end, e_begin, star - e_begin);
+            if (found == p_end && e_begin != star)
             {
-                // These characters must match
                 return false;
             }
-            else
-            {
-                // Advance both by one
-                ++path_it;
-                ++expression_it;
-            }
+            p_begin = found + (star - e_begin);
+            e_begin = star + 1;
+            star = std::find(e_begin, e_end, '*');
         }
 
-        // Return true only if we've consumed all of the expression
-        if (expression_it == e_end)
+        // The last run must be at the very end if anchored, and anywhere otherwise
+        length = e_end - e_begin;
+        if (anchored)
         {
-            return true;
+            return static_cast<size_t>(p_end - p_begin) >= length &&
+                Literal::equal(e_begin, p_end - length, length);
         }
-        else if (*expression_it == '$')
+        return length == 0 || Literal::search(p_begin, p_end, e_begin, length) != p_end;
+    }
+
+    size_t Directive::lead() const
+    {
+        size_t length = 0;
+        while (length < expression_.size() && expression_[length] != '*' &&
+               expression_[length] != '$')
         {
-            return path_it == p_end;
+            ++length;
         }
-        else
+        return length;
+    }
+
+    size_t Directive::memory_usage() const
+    {
+        size_t result = sizeof(Directive);
+        if (!expression_.get_allocator().arena())
         {
-            return false;
+            result += Usage::string(expression_);
         }
+        return result;
     }
 
     std::string Directive::str() const
@@ -124,7 +226,24 @@ namespace Rep
 
     bool Directive::match(const std::string& path) const
     {
-        return match(expression_.begin(), expression_.end(), path.begin(), path.end());
+        return match(path.data(), path.size());
+    }
+
+    bool Directive::match(const char* path, size_t length) const
+    {
+        switch (kind_)
+        {
+            case Kind::prefix:
+                return match<Kind::prefix>(path, length);
+            case Kind::exact:
+                return match<Kind::exact>(path, length);
+            case Kind::infix:
+                return match<Kind::infix>(path, length);
+            case Kind::suffix:
+                return match<Kind::suffix>(path, length);
+            default:
+                return match<Kind::general>(path, length);
+        }
     }
 
 }
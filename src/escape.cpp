@@ -0,0 +1,114 @@
+#include "escape.h"
+
+namespace
+{
+    /**
+     * Which characters may appear unescaped in a path (or its params), and which in a
+     * query, where '?' may appear too.
+     */
+    struct Table
+    {
+        Table() : path(), query()
+        {
+            for (int chr = 0; chr < 256; ++chr)
+            {
+                path[chr] = (chr >= 'a' && chr <= 'z') || (chr >= 'A' && chr <= 'Z') ||
+                    (chr >= '0' && chr <= '9');
+            }
+            for (const char* chr = "-._~!$&'()*+,;=:@/"; *chr; ++chr)
+            {
+                path[static_cast<unsigned char>(*chr)] = true;
+            }
+            for (int chr = 0; chr < 256; ++chr)
+            {
+                query[chr] = path[chr] || chr == '?';
+            }
+        }
+
+        bool path[256];
+        bool query[256];
+    };
+
+    const Table table;
+
+    /**
+     * Return the value of the hex digit, or -1 if it is not one.
+     */
+    int hex(char chr)
+    {
+        if (chr >= '0' && chr <= '9')
+        {
+            return chr - '0';
+        }
+        chr |= 0x20;
+        return (chr >= 'a' && chr <= 'f') ? chr - 'a' + 10 : -1;
+    }
+
+    char upper(char chr)
+    {
+        return (chr >= 'a' && chr <= 'z') ? chr - 'a' + 'A' : chr;
+    }
+}
+
+namespace Rep
+{
+    bool Escape::path(const char* begin, const char* end, std::string& result)
+    {
+        if (begin == end || (*begin != '/' && *begin != '*') ||
+            (end - begin >= 2 && begin[0] == '/' && begin[1] == '/'))
+        {
+            return false;
+        }
+
+        static const char digits[] = "0123456789ABCDEF";
+        result.clear();
+        result.reserve(end - begin + 1);
+        if (*begin != '/')
+        {
+            result.push_back('/');
+        }
+        const bool* safe = table.path;
+        for (const char* cursor = begin; cursor < end; ++cursor)
+        {
+            unsigned char chr = *cursor;
+            if (chr == '#')
+            {
+                break;
+            }
+            else if (chr == '?' && safe == table.path)
+            {
+                safe = table.query;
+                result.push_back(chr);
+            }
+            else if (chr == '%' && end - cursor > 2 &&
+                     hex(cursor[1]) >= 0 && hex(cursor[2]) >= 0)
+            {
+                // Valid escapes are decoded if they needn't be escaped, and are
+                // otherwise normalized to uppercase
+                unsigned char value = hex(cursor[1]) * 16 + hex(cursor[2]);
+                if (safe[value])
+                {
+                    result.push_back(value);
+                }
+                else
+                {
+                    result.push_back('%');
+                    result.push_back(upper(cursor[1]));
+                    result.push_back(upper(cursor[2]));
+                }
+                cursor += 2;
+            }
+            else if (safe[chr])
+            {
+                result.push_back(chr);
+            }
+            else
+            {
+                result.push_back('%');
+                result.push_back(digits[chr >> 4]);
+                result.push_back(digits[chr & 0x0F]);
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,155 @@
+#include <numeric>
+
+#include "url.h"
+
+#include "escape.h"
+#include "index.h"
+#include "usage.h"
+
+namespace Rep
+{
+    RobotsIndex::RobotsIndex(const std::string& agent, bool missing)
+        : agent_(agent), missing_(missing), sites_()
+    {
+    }
+
+    void RobotsIndex::insert(const std::string& url, const Robots& robots)
+    {
+        std::string key(Robots::robotsUrl(url));
+        Agent agent(robots.agent(agent_));
+        agent.compile();
+        sites_.erase(key);
+        sites_.emplace(key, std::move(agent));
+    }
+
+    void RobotsIndex::insert(const std::string& url, const std::string& content)
+    {
+        Robots::Options options;
+        options.agents.insert(agent_);
+        insert(url, Robots(content, Robots::robotsUrl(url), options));
+    }
+
+    void RobotsIndex::erase(const std::string& url)
+    {
+        sites_.erase(Robots::robotsUrl(url));
+    }
+
+    bool RobotsIndex::contains(const std::string& url) const
+    {
+        return find(url.substr(0, authority(url)));
+    }
+
+    size_t RobotsIndex::memory_usage() const
+    {
+        size_t result = sizeof(RobotsIndex) + Usage::string(agent_) +
+            Usage::table(sites_);
+        for (const auto& site : sites_)
+        {
+            result += Usage::string(site.first) + site.second.memory_usage() -
+                sizeof(Agent);
+        }
+        return result;
+    }
+
+    bool RobotsIndex::allowed(const std::string& url) const
+    {
+        size_t offset = authority(url);
+        std::string buffer;
+        return check(find(url.substr(0, offset)), url, offset, buffer);
+    }
+
+    void RobotsIndex::allowed_batch(
+        const std::vector<std::string>& urls, std::vector<bool>& results) const
+    {
+        results.resize(urls.size());
+
+        // Number each distinct scheme and authority in order of appearance, looking
+        // up the rules for each only once
+        std::unordered_map<std::string, size_t> groups;
+        std::vector<const Agent*> agents;
+        std::vector<size_t> group(urls.size());
+        std::vector<size_t> offsets(urls.size());
+        std::string buffer;
+        for (size_t index = 0; index < urls.size(); ++index)
+        {
+            offsets[index] = authority(urls[index]);
+            buffer.assign(urls[index], 0, offsets[index]);
+            auto it = groups.find(buffer);
+            if (it == groups.end())
+            {
+                it = groups.emplace(buffer, agents.size()).first;
+                agents.push_back(find(buffer));
+            }
+            group[index] = it->second;
+        }
+
+        // Then order the URLs by group, with a counting sort, and check each group's
+        // URLs together
+        std::vector<size_t> starts(agents.size() + 1, 0);
+        for (size_t index = 0; index < urls.size(); ++index)
+        {
+            ++starts[group[index] + 1];
+        }
+        std::partial_sum(starts.begin(), starts.end(), starts.begin());
+        std::vector<size_t> order(urls.size());
+        for (size_t index = 0; index < urls.size(); ++index)
+        {
+            order[starts[group[index]]++] = index;
+        }
+
+        for (size_t index : order)
+        {
+            results[index] =
+                check(agents[group[index]], urls[index], offsets[index], buffer);
+        }
+    }
+
+    size_t RobotsIndex::authority(const std::string& url)
+    {
+        size_t scheme = url.find("://");
+        if (scheme == std::string::npos)
+        {
+            return 0;
+        }
+        size_t end = url.find_first_of("/?#", scheme + 3);
+        return end == std::string::npos ? url.size() : end;
+    }
+
+    const Agent* RobotsIndex::find(const std::string& authority) const
+    {
+        if (authority.empty())
+        {
+            return nullptr;
+        }
+
+        std::string key;
+        try
+        {
+            key = Robots::robotsUrl(authority);
+        }
+        catch (const std::exception&)
+        {
+            return nullptr;
+        }
+        auto it = sites_.find(key);
+        return it == sites_.end() ? nullptr : &it->second;
+    }
+
+    bool RobotsIndex::check(const Agent* agent, const std::string& url, size_t offset,
+                            std::string& buffer) const
+    {
+        if (!agent)
+        {
+            return missing_;
+        }
+
+        const char* begin = url.data() + offset;
+        if (!Escape::path(begin, url.data() + url.size(), buffer))
+        {
+            // Such as an empty path, or one that starts with a query
+            Url::Url parsed(url);
+            buffer = parsed.defrag().escape().fullpath();
+        }
+        return agent->allowed_path(buffer);
+    }
+}
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "literal.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+namespace
+{
+    /**
+     * Return the index of the lowest set bit of a non-zero mask.
+     */
+    unsigned lowest(unsigned mask)
+    {
+        return __builtin_ctz(mask);
+    }
+}
+#endif
+
+namespace Rep
+{
+    namespace Literal
+    {
+        bool equal(const char* lhs, const char* rhs, size_t length)
+        {
+            // Most literals are short, and memcmp is already vectorized for long ones
+            for (; length >= 16; lhs += 16, rhs += 16, length -= 16)
+            {
+#ifdef __SSE2__
+                __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs));
+                __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(left, right)) != 0xFFFF)
+                {
+                    return false;
+                }
+#else
+                if (std::memcmp(lhs, rhs, 16) != 0)
+                {
+                    return false;
+                }
+#endif
+            }
+            for (; length; ++lhs, ++rhs, --length)
+            {
+                if (*lhs != *rhs)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        const char* search(const char* begin, const char* end,
+                           const char* needle, size_t length)
+        {
+            if (length == 0)
+            {
+                return begin;
+            }
+            if (static_cast<size_t>(end - begin) < length)
+            {
+                return end;
+            }
+            if (length == 1)
+            {
+                const void* found = std::memchr(begin, *needle, end - begin);
+                return found ? static_cast<const char*>(found) : end;
+            }
+
+            // Candidates are positions where both the first and the last characters of
+            // the needle match, compared a block at a time; only those are verified.
+            const char* last = end - length + 1;
+            const char* position = begin;
+#ifdef __AVX2__
+            const __m256i first32 = _mm256_set1_epi8(needle[0]);
+            const __m256i final32 = _mm256_set1_epi8(needle[length - 1]);
+            for (; last - position >= 32; position += 32)
+            {
+                __m256i front = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(position));
+                __m256i back = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(position + length - 1));
+                unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(
+                    _mm256_cmpeq_epi8(front, first32), _mm256_cmpeq_epi8(back, final32)));
+                for (; mask; mask &= mask - 1)
+                {
+                    const char* candidate = position + lowest(mask);
+                    if (equal(candidate + 1, needle + 1, length - 2))
+                    {
+                        return candidate;
+                    }
+                }
+            }
+#endif
+#ifdef __SSE2__
+            const __m128i first16 = _mm_set1_epi8(needle[0]);
+            const __m128i final16 = _mm_set1_epi8(needle[length - 1]);
+            for (; last - position >= 16; position += 16)
+            {
+                __m128i front = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(position));
+                __m128i back = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(position + length - 1));
+                unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+                    _mm_cmpeq_epi8(front, first16), _mm_cmpeq_epi8(back, final16)));
+                for (; mask; mask &= mask - 1)
+                {
+                    const char* candidate = position + lowest(mask);
+                    if (equal(candidate + 1, needle + 1, length - 2))
+                    {
+                        return candidate;
+                    }
+                }
+            }
+#endif
+            for (; position != last; ++position)
+            {
+                if (*position == needle[0] && position[length - 1] == needle[length - 1]
+                    && equal(position + 1, needle + 1, length - 2))
+                {
+                    return position;
+                }
+            }
+            return end;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#include <cstring>
+#include <limits>
+
+#include "parser.h"
+
+namespace Rep
+{
+    const size_t RobotsParser::unlimited = std::numeric_limits<size_t>::max();
+
+    RobotsParser::RobotsParser(const std::string& base_url,
+                               const Robots::Options& options, size_t budget)
+        : options_(options), base_url_(base_url), robots_(options, base_url, 0)
+        , state_(options), partial_(), content_(), budget_(budget), consumed_(0), started_(false), truncated_(false)
+    {
+    }
+
+    bool RobotsParser::feed(const char* data, size_t length)
+    {
+        if (length > budget_ - consumed_)
+        {
+            length = budget_ - consumed_;
+            truncated_ = true;
+        }
+        consumed_ += length;
+        const char* end = data + length;
+
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', length));
+        if (!newline)
+        {
+            partial_.append(data, length);
+            return !truncated_;
+        }
+
+        // Finish the line begun in earlier chunks
+        if (!partial_.empty())
+        {
+            partial_.append(data, newline + 1);
+            parse(partial_.data(), partial_.data() + partial_.size());
+            partial_.clear();
+            data = newline + 1;
+        }
+
+        // Every complete line left in the chunk is parsed in place
+        const char* last = data;
+        for (const char* chr = end; chr != data; --chr)
+        {
+            if (*(chr - 1) == '\n')
+            {
+                last = chr;
+                break;
+            }
+        }
+        parse(data, last);
+        partial_.assign(last, end);
+        return !truncated_;
+    }
+
+    Robots RobotsParser::finish()
+    {
+        parse(partial_.data(), partial_.data() + partial_.size());
+        partial_.clear();
+        if (!state_.needed.empty())
+        {
+            // As Robots does, parse again building the skipped agent that is needed
+            return Robots(content_.data(), content_.size(), base_url_, options_);
+        }
+        robots_.finish(state_, options_);
+        return std::move(robots_);
+    }
+
+    void RobotsParser::parse(const char* begin, const char* end)
+    {
+        if (!state_.wanted.empty())
+        {
+            content_.append(begin, end);
+        }
+        if (!started_ && begin != end)
+        {
+            started_ = true;
+            if (end - begin >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0)
+            {
+                begin += 3;
+            }
+        }
+
+        Robots::range_t key, value;
+        while (state_.needed.empty() && Robots::getpair(begin, end, key, value))
+        {
+            robots_.line(state_, key, value);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#include <cstdint>
+
+#include "pool.h"
+
+namespace Rep
+{
+    void RulePool::intern(Agent& agent)
+    {
+        const Agent::directives_t& directives = *agent.directives_;
+        size_t key = hash(directives);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto range = sets_.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (equal(*it->second, directives))
+            {
+                agent.directives_ = it->second;
+                return;
+            }
+        }
+
+        if (agent.arena())
+        {
+            agent.directives_ = Agent::clone(directives, nullptr);
+        }
+        // Keep pruning in proportion to the sets added
+        if (sets_.size() >= 64 && (sets_.size() & (sets_.size() - 1)) == 0)
+        {
+            prune();
+        }
+        sets_.emplace(key, agent.directives_);
+    }
+
+    size_t RulePool::size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        prune();
+        return sets_.size();
+    }
+
+    size_t RulePool::hash(const Agent::directives_t& directives)
+    {
+        // FNV-1a, over each expression followed by its verdict
+        uint64_t result = 14695981039346656037ull;
+        auto mix = [&result](unsigned char byte) {
+            result = (result ^ byte) * 1099511628211ull;
+        };
+        for (const auto& directive : directives)
+        {
+            for (auto chr : directive.expression())
+            {
+                mix(chr);
+            }
+            mix(directive.allowed() ? 0xFF : 0xFE);
+        }
+        return static_cast<size_t>(result);
+    }
+
+    bool RulePool::equal(const Agent::directives_t& lhs, const Agent::directives_t& rhs)
+    {
+        if (lhs.size() != rhs.size())
+        {
+            return false;
+        }
+        for (size_t index = 0; index < lhs.size(); ++index)
+        {
+            if (lhs[index].allowed() != rhs[index].allowed() ||
+                lhs[index].expression() != rhs[index].expression())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void RulePool::prune()
+    {
+        for (auto it = sets_.begin(); it != sets_.end();)
+        {
+            if (it->second.use_count() == 1)
+            {
+                it = sets_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
@@ -1,52 +1,102 @@
 #include <algorithm>
-#include <functional>
 #include <cctype>
-#include <locale>
-#include <sstream>
+#include <cstring>
 #include <iostream>
+#include <sstream>
 #include <unordered_map>
 
 #include "url.h"
 
+#include "buckets.h"
+#include "pool.h"
 #include "robots.h"
+#include "snapshot.h"
+#include "usage.h"
+
+namespace
+{
+    bool space(const char chr)
+    {
+        return chr == ' ' || (chr >= '\t' && chr <= '\r');
+    }
+
+    /**
+     * Return true if the range is a case-insensitive match for the lowercase name.
+     */
+    bool is(const std::pair<const char*, const char*>& range, const char* name)
+    {
+        size_t length = std::strlen(name);
+        if (static_cast<size_t>(range.second - range.first) != length)
+        {
+            return false;
+        }
+        for (const char* chr = range.first; chr != range.second; ++chr, ++name)
+        {
+            if (::tolower(*chr) != *name)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
 
 namespace Rep
 {
+    const size_t Robots::npos = static_cast<size_t>(-1);
 
-    void Robots::strip(std::string& string)
+    Robots::State::State(const Options& options)
+        : agent_name("*"), group(), shares(1, 1), last_agent(false), current(0)
+        , buffer(), wanted(), skipped(), inherited(false), needed()
     {
-        string.erase(string.begin(), std::find_if(string.begin(), string.end(),
-            std::not1(std::ptr_fun<int, int>(std::isspace))));
-        string.erase(std::find_if(string.rbegin(), string.rend(),
-            std::not1(std::ptr_fun<int, int>(std::isspace))).base(), string.end());
+        for (const auto& name : options.agents)
+        {
+            std::string lowered(name);
+            std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+            wanted.insert(lowered);
+        }
     }
 
-    bool Robots::getpair(std::istringstream& stream, std::string& key, std::string& value)
+    bool Robots::getpair(
+        const char*& cursor, const char* end, range_t& key, range_t& value)
     {
-        while (getline(stream, key))
+        while (cursor != end)
         {
-            size_t index = key.find('#');
-            if (index != std::string::npos)
+            const char* line = cursor;
+            const char* newline = static_cast<const char*>(
+                std::memchr(cursor, '\n', end - cursor));
+            const char* line_end = newline ? newline : end;
+            cursor = newline ? newline + 1 : end;
+
+            const char* hash = static_cast<const char*>(
+                std::memchr(line, '#', line_end - line));
+            if (hash)
             {
-                key.resize(index);
+                line_end = hash;
             }
 
             // Find the colon and divide it into key and value, skipping malformed lines
-            index = key.find(':');
-            if (index == std::string::npos)
+            const char* colon = static_cast<const char*>(
+                std::memchr(line, ':', line_end - line));
+            if (!colon)
             {
                 continue;
             }
 
-            value.assign(key.begin() + index + 1, key.end());
-            key.resize(index);
-
             // Strip whitespace off of each
-            strip(key);
-            strip(value);
+            key.first = std::find_if_not(line, colon, space);
+            key.second = colon;
+            while (key.second != key.first && space(*(key.second - 1)))
+            {
+                --key.second;
+            }
 
-            // Lowercase the key
-            std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+            value.first = std::find_if_not(colon + 1, line_end, space);
+            value.second = line_end;
+            while (value.second != value.first && space(*(value.second - 1)))
+            {
+                --value.second;
+            }
 
             return true;
         }
@@ -58,84 +108,313 @@ namespace Rep
     {
     }
 
-    Robots::Robots(const std::string& content, const std::string& base_url) :
+    Robots::Robots(const std::string& content, const std::string& base_url,
+                   const Options& options) :
+        Robots(content.data(), content.size(), base_url, options)
+    {
+    }
+
+    Robots::Robots(const char* content, size_t length, const std::string& base_url,
+                   const Options& options) :
+        Robots(options, base_url, length)
+    {
+        const char* cursor = content;
+        const char* end = content + length;
+        if (length >= 3 && std::memcmp(content, "\xEF\xBB\xBF", 3) == 0)
+        {
+            cursor += 3;
+        }
+        State state(options);
+        range_t key, value;
+        while (state.needed.empty() && Robots::getpair(cursor, end, key, value))
+        {
+            line(state, key, value);
+        }
+        if (!state.needed.empty())
+        {
+            // A wanted agent shares the rules of a skipped one, so parse those too
+            Options wider(options);
+            wider.agents.insert(state.needed);
+            Robots restarted(content, length, base_url, wider);
+            swap(restarted);
+            return;
+        }
+        finish(state, options);
+    }
+
+    Robots::Robots(const Options& options, const std::string& base_url, size_t length) :
+        arena_(options.arena ? std::make_shared<Arena>(length + 1024) : nullptr),
         host_(Url::Url(base_url).host()),
-        agents_(),
+        agents_(agents_t::allocator_type(arena_.get())),
+        names_(1, names_t::hasher(), names_t::key_equal(),
+               names_t::allocator_type(arena_.get())),
         sitemaps_(),
-        default_(agents_.emplace("*", Agent(host_)).first->second)
+        default_(0),
+        lazy_(options.lazy ? new Lazy(options) : nullptr)
     {
-        std::string agent_name("*");
-        std::istringstream input(content);
-        if (content.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        agents_.emplace_back(host_, arena_.get());
+        agents_.back().unsorted();
+        names_.emplace("*", 0);
+        if (lazy_)
         {
-            input.ignore(3);
+            lazy_->spans.emplace_back();
         }
-        std::string key, value;
-        std::vector<std::string> group;
-        bool last_agent = false;
-        agent_map_t::iterator current = agents_.find("*");
-        while (Robots::getpair(input, key, value))
+    }
+
+    Robots::Robots(const Robots& rhs) :
+        arena_(),
+        host_(rhs.host_),
+        agents_(),
+        names_(rhs.names_),
+        sitemaps_(rhs.sitemaps_),
+        default_(rhs.default_),
+        lazy_()
+    {
+        rhs.materialize();
+        agents_ = rhs.agents_;
+    }
+
+    Robots& Robots::operator=(const Robots& rhs)
+    {
+        Robots copy(rhs);
+        return *this = std::move(copy);
+    }
+
+    Robots& Robots::operator=(Robots&& rhs)
+    {
+        // Not moved member by member, which would release the old arena before the
+        // old agents and names in it
+        swap(rhs);
+        return *this;
+    }
+
+    void Robots::swap(Robots& rhs)
+    {
+        arena_.swap(rhs.arena_);
+        host_.swap(rhs.host_);
+        agents_.swap(rhs.agents_);
+        names_.swap(rhs.names_);
+        sitemaps_.swap(rhs.sitemaps_);
+        std::swap(default_, rhs.default_);
+        lazy_.swap(rhs.lazy_);
+    }
+
+    void Robots::Lazy::defer(size_t agent, const range_t& key, const range_t& value)
+    {
+        size_t begin = content.size();
+        content.append(key.first, key.second);
+        content.push_back(':');
+        content.append(value.first, value.second);
+        content.push_back('\n');
+
+        // Consecutive lines for the same agent share a span
+        auto& ranges = spans[agent];
+        if (!ranges.empty() && ranges.back().second == begin)
         {
-            if (key.compare("user-agent") == 0)
-            {
-                // Store the user agent string as lowercased
-                std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+            ranges.back().second = content.size();
+        }
+        else
+        {
+            ranges.emplace_back(begin, content.size());
+        }
+    }
 
-                if (last_agent)
+    void Robots::line(State& state, const range_t& key, const range_t& value)
+    {
+        std::string& buffer = state.buffer;
+        buffer.assign(value.first, value.second);
+        if (is(key, "user-agent"))
+        {
+            // Store the user agent string as lowercased
+            std::transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
+
+            bool wanted = state.wanted.empty() || buffer == "*" ||
+                state.wanted.count(buffer);
+            if (!state.last_agent)
+            {
+                if (!state.agent_name.empty())
+                {
+                    share(state);
+                }
+                state.agent_name = buffer;
+                state.current = npos;
+                if (wanted)
                 {
-                    group.push_back(value);
+                    start(state, buffer);
                 }
                 else
                 {
-                    if (!agent_name.empty())
+                    state.inherited = !state.skipped.insert(buffer).second;
+                }
+            }
+            else if (wanted && state.current == npos)
+            {
+                // The group's first name was skipped. As in share(), this name only
+                // joins the group if it is not yet bound, and then it shares the first
+                // name's agent, which must be parsed too if it has earlier rules.
+                if (!names_.count(buffer))
+                {
+                    if (state.inherited)
                     {
-                        for (auto other : group)
-                        {
-                            agents_.emplace(other, current->second);
-                        }
-                        group.clear();
+                        state.needed = state.agent_name;
+                    }
+                    else
+                    {
+                        start(state, buffer);
                     }
-                    agent_name = value;
-                    current = agents_.emplace(agent_name, Agent(host_)).first;
                 }
-                last_agent = true;
-                continue;
+            }
+            else if (wanted)
+            {
+                state.group.push_back(buffer);
             }
             else
             {
-                last_agent = false;
+                state.skipped.insert(buffer);
             }
+            state.last_agent = true;
+            return;
+        }
+        else
+        {
+            state.last_agent = false;
+        }
 
-            if (key.compare("sitemap") == 0)
+        if (is(key, "sitemap"))
+        {
+            sitemaps_.push_back(buffer);
+            return;
+        }
+        if (state.current == npos)
+        {
+            // The rules of skipped groups are not parsed
+            return;
+        }
+        if (lazy_)
+        {
+            lazy_->defer(state.current, key, value);
+            return;
+        }
+        rule(agents_[state.current], key, buffer);
+    }
+
+    void Robots::rule(Agent& agent, const range_t& key, const std::string& value)
+    {
+        if (is(key, "disallow"))
+        {
+            agent.disallow(value);
+        }
+        else if (is(key, "allow"))
+        {
+            agent.allow(value);
+        }
+        else if (is(key, "crawl-delay"))
+        {
+            try
             {
-                sitemaps_.push_back(value);
+                agent.delay(std::stof(value));
             }
-            else if (key.compare("disallow") == 0)
+            catch (const std::exception&)
             {
-                current->second.disallow(value);
+                std::cerr << "Could not parse " << value << " as float." << std::endl;
             }
-            else if (key.compare("allow") == 0)
+        }
+    }
+
+    void Robots::start(State& state, const std::string& name)
+    {
+        auto named = names_.emplace(name, agents_.size());
+        if (named.second)
+        {
+            agents_.emplace_back(host_, arena_.get());
+            agents_.back().unsorted();
+            state.shares.push_back(1);
+            if (lazy_)
             {
-                current->second.allow(value);
+                lazy_->spans.emplace_back();
             }
-            else if (key.compare("crawl-delay") == 0)
+        }
+        else if (state.shares[named.first->second] > 1)
+        {
+            // The agent is shared with an earlier group's other names, so this name's
+            // further rules go to its own copy of it
+            --state.shares[named.first->second];
+            Agent copy(agents_[named.first->second], arena_.get());
+            if (lazy_)
             {
-                try
-                {
-                    current->second.delay(std::stof(value));
-                }
-                catch (const std::exception&)
-                {
-                    std::cerr << "Could not parse " << value << " as float." << std::endl;
-                }
+                auto spans = lazy_->spans[named.first->second];
+                lazy_->spans.push_back(std::move(spans));
+            }
+            named.first->second = agents_.size();
+            agents_.push_back(std::move(copy));
+            state.shares.push_back(1);
+        }
+        state.current = named.first->second;
+    }
+
+    void Robots::share(State& state)
+    {
+        for (auto& other : state.group)
+        {
+            if (names_.emplace(std::move(other), state.current).second)
+            {
+                ++state.shares[state.current];
+            }
+        }
+        state.group.clear();
+    }
+
+    void Robots::finish(State& state, const Options& options)
+    {
+        if (!state.agent_name.empty())
+        {
+            share(state);
+        }
+        default_ = names_.find("*")->second;
+
+        if (lazy_)
+        {
+            // Agents are finished as their rules are parsed
+            lazy_->parsed.reset(new std::atomic<bool>[agents_.size()]());
+            return;
+        }
+
+        // Directives are appended as they are parsed, and sorted once at the end
+        for (auto& agent : agents_)
+        {
+            agent.sort();
+        }
+
+        if (options.minimize)
+        {
+            for (auto& agent : agents_)
+            {
+                agent.minimize();
+            }
+        }
+
+        if (options.pool)
+        {
+            for (auto& agent : agents_)
+            {
+                options.pool->intern(agent);
             }
         }
 
-        if (!agent_name.empty())
+        // Checks of agents with many directives only try those that could match
+        for (auto& agent : agents_)
         {
-            for (auto other : group)
+            if (agent.directives().size() >= Buckets::minimum)
             {
-                agents_.emplace(other, current->second);
+                agent.bucket();
+            }
+        }
+
+        if (options.stats)
+        {
+            for (auto& agent : agents_)
+            {
+                agent.instrument();
             }
         }
     }
@@ -146,14 +425,73 @@ namespace Rep
         std::string lowered(name);
         std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
 
-        auto it = agents_.find(lowered);
-        if (it == agents_.end())
+        auto it = names_.find(lowered);
+        size_t index = it == names_.end() ? default_ : it->second;
+        materialize(index);
+        return agents_[index];
+    }
+
+    void Robots::materialize(size_t index) const
+    {
+        // Not std::call_once, which cannot be relied upon to allow another try if
+        // parsing throws
+        if (lazy_ && !lazy_->parsed[index].load(std::memory_order_acquire))
         {
-            return default_;
+            // Agents may share the arena and the pool, so only one is parsed at a time
+            std::lock_guard<std::mutex> lock(lazy_->mutex);
+            if (!lazy_->parsed[index].load(std::memory_order_relaxed))
+            {
+                parse(index);
+                lazy_->parsed[index].store(true, std::memory_order_release);
+            }
         }
-        else
+    }
+
+    void Robots::parse(size_t index) const
+    {
+        // The agent is built aside and only published once complete, so that if
+        // applying a rule throws, the next lookup parses it again from the start
+        Agent agent(agents_[index], arena_.get());
+        std::string buffer;
+        range_t key, value;
+        for (const auto& span : lazy_->spans[index])
         {
-            return it->second;
+            const char* cursor = lazy_->content.data() + span.first;
+            const char* end = lazy_->content.data() + span.second;
+            while (Robots::getpair(cursor, end, key, value))
+            {
+                buffer.assign(value.first, value.second);
+                rule(agent, key, buffer);
+            }
+        }
+        agent.sort();
+
+        if (lazy_->minimize)
+        {
+            agent.minimize();
+        }
+        if (lazy_->pool)
+        {
+            lazy_->pool->intern(agent);
+        }
+        if (agent.directives().size() >= Buckets::minimum)
+        {
+            agent.bucket();
+        }
+        if (lazy_->stats)
+        {
+            agent.instrument();
+        }
+
+        agents_[index] = std::move(agent);
+        lazy_->spans[index].clear();
+    }
+
+    void Robots::materialize() const
+    {
+        for (size_t index = 0; index < agents_.size(); ++index)
+        {
+            materialize(index);
         }
     }
 
@@ -162,26 +500,174 @@ namespace Rep
         return agent(name).allowed(path);
     }
 
+    void Robots::allowed_batch(const std::vector<std::string>& paths,
+                               const std::string& name,
+                               std::vector<bool>& results) const
+    {
+        agent(name).allowed_batch(paths, results);
+    }
+
+    size_t Robots::memory_usage() const
+    {
+        size_t result = sizeof(Robots) + Usage::string(host_) +
+            Usage::vector(sitemaps_);
+        std::unique_lock<std::mutex> lock;
+        if (lazy_)
+        {
+            // Agents may be being parsed meanwhile
+            lock = std::unique_lock<std::mutex>(lazy_->mutex);
+            result += sizeof(Lazy) + Usage::string(lazy_->content) +
+                Usage::vector(lazy_->spans) + agents_.size() * sizeof(std::atomic<bool>);
+            for (const auto& spans : lazy_->spans)
+            {
+                result += Usage::vector(spans);
+            }
+        }
+        const Arena* arena = agents_.get_allocator().arena();
+        if (arena)
+        {
+            // The agents, names and directives are all in the arena
+            result += sizeof(Arena) + arena->capacity();
+        }
+        else
+        {
+            result += Usage::vector(agents_) + Usage::table(names_);
+        }
+        for (const auto& agent : agents_)
+        {
+            result += agent.memory_usage() - sizeof(Agent);
+        }
+        for (const auto& name : names_)
+        {
+            result += Usage::string(name.first);
+        }
+        for (const auto& sitemap : sitemaps_)
+        {
+            result += Usage::string(sitemap);
+        }
+        return result;
+    }
+
     std::string Robots::str() const
     {
+        materialize();
         std::stringstream out;
         // TODO: include sitepath info
         out << '{';
-        auto begin = agents_.begin();
-        auto end = agents_.end();
+        auto begin = names_.begin();
+        auto end = names_.end();
         if (begin != end)
         {
-            out << '"' << begin->first << '"' << ": " << begin->second.str();
+            out << '"' << begin->first << '"' << ": " << agents_[begin->second].str();
             ++begin;
         }
         for (; begin != end; ++begin)
         {
-            out << ", \"" << begin->first << '"' << ": " << begin->second.str();
+            out << ", \"" << begin->first << '"' << ": "
+                << agents_[begin->second].str();
         }
         out << '}';
         return out.str();
     }
 
+    std::string Robots::serialize() const
+    {
+        materialize();
+        // Names are sorted so that a snapshot can binary search them, and the names
+        // sharing an agent share its directives
+        std::vector<names_t::const_iterator> agents;
+        for (auto it = names_.begin(); it != names_.end(); ++it)
+        {
+            agents.push_back(it);
+        }
+        typedef names_t::const_iterator entry_t;
+        std::sort(agents.begin(), agents.end(),
+            [](const entry_t& a, const entry_t& b) {
+                return a->first < b->first;
+            });
+        std::vector<size_t> firsts;
+        size_t directive_count = 0;
+        for (const auto& agent : agents_)
+        {
+            firsts.push_back(directive_count);
+            directive_count += agent.directives().size();
+        }
+
+        size_t tables = Snapshot::header_size
+            + agents.size() * Snapshot::agent_size
+            + directive_count * Snapshot::directive_size
+            + sitemaps_.size() * Snapshot::sitemap_size;
+        std::string result;
+        std::string strings;
+        auto put = [](std::string& out, size_t value) {
+            for (size_t shift = 0; shift < 32; shift += 8)
+            {
+                out.push_back(static_cast<char>((value >> shift) & 0xFF));
+            }
+        };
+        auto store = [&](const char* data, size_t length) {
+            put(result, tables + strings.size());
+            put(result, length);
+            strings.append(data, length);
+        };
+
+        // Header
+        result.append(Snapshot::magic, sizeof(Snapshot::magic));
+        put(result, Snapshot::version);
+        put(result, 0);
+        store(host_.data(), host_.size());
+        size_t default_index = 0;
+        while (agents[default_index]->first != "*")
+        {
+            ++default_index;
+        }
+        put(result, default_index);
+        put(result, agents.size());
+        put(result, Snapshot::header_size);
+        put(result, directive_count);
+        put(result, Snapshot::header_size + agents.size() * Snapshot::agent_size);
+        put(result, sitemaps_.size());
+        put(result, tables - sitemaps_.size() * Snapshot::sitemap_size);
+
+        // Agents
+        for (const auto& it : agents)
+        {
+            const Agent& agent = agents_[it->second];
+            store(it->first.data(), it->first.size());
+            put(result, firsts[it->second]);
+            put(result, agent.directives().size());
+            uint32_t bits;
+            Agent::delay_t delay = agent.delay();
+            std::memcpy(&bits, &delay, sizeof(bits));
+            put(result, bits);
+        }
+
+        // Directives
+        for (const auto& agent : agents_)
+        {
+            for (const auto& directive : agent.directives())
+            {
+                store(directive.expression().data(), directive.expression().size());
+                put(result, directive.priority());
+                put(result, directive.allowed() ? 1 : 0);
+            }
+        }
+
+        // Sitemaps
+        for (const auto& sitemap : sitemaps_)
+        {
+            store(sitemap.data(), sitemap.size());
+        }
+
+        result.append(strings);
+
+        // Now that the size is known, fill it in
+        std::string size;
+        put(size, result.size());
+        result.replace(8, 4, size);
+        return result;
+    }
+
     std::string Robots::robotsUrl(const std::string& url)
     {
         return Url::Url(url)
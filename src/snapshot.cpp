@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "url.h"
+
+#include "directive.h"
+#include "snapshot.h"
+
+namespace Rep
+{
+    const char Snapshot::magic[4] = {'R', 'E', 'P', 'S'};
+    const uint32_t Snapshot::version = 1;
+    const size_t Snapshot::header_size = 48;
+    const size_t Snapshot::agent_size = 20;
+    const size_t Snapshot::directive_size = 16;
+    const size_t Snapshot::sitemap_size = 8;
+
+    Snapshot::Snapshot(const char* data, size_t size)
+        : data_(data), size_(size), host_(), default_(0)
+        , agent_count_(0), agents_(0)
+        , directive_count_(0), directives_(0)
+        , sitemap_count_(0), sitemaps_(0)
+    {
+        if (size < header_size || std::memcmp(data, magic, sizeof(magic)) != 0)
+        {
+            throw std::invalid_argument("Not a robots.txt snapshot");
+        }
+        if (word(4) != version)
+        {
+            throw std::invalid_argument("Unsupported robots.txt snapshot version");
+        }
+        if (word(8) > size || word(8) < header_size)
+        {
+            throw std::invalid_argument("Truncated robots.txt snapshot");
+        }
+        size_ = word(8);
+
+        check(word(12), word(16));
+        host_.assign(data_ + word(12), word(16));
+        default_ = word(20);
+        agent_count_ = word(24);
+        agents_ = word(28);
+        directive_count_ = word(32);
+        directives_ = word(36);
+        sitemap_count_ = word(40);
+        sitemaps_ = word(44);
+        check(agents_, agent_count_ * agent_size);
+        check(directives_, directive_count_ * directive_size);
+        check(sitemaps_, sitemap_count_ * sitemap_size);
+        if (default_ >= agent_count_)
+        {
+            throw std::invalid_argument("Invalid default agent in robots.txt snapshot");
+        }
+
+        // Validate every reference up front, so that queries need no checks
+        for (size_t index = 0; index < agent_count_; ++index)
+        {
+            size_t record = agents_ + index * agent_size;
+            check(word(record), word(record + 4));
+            if (static_cast<size_t>(word(record + 8)) + word(record + 12) >
+                directive_count_)
+            {
+                throw std::invalid_argument("Invalid directives in robots.txt snapshot");
+            }
+        }
+        for (size_t index = 0; index < directive_count_; ++index)
+        {
+            size_t record = directives_ + index * directive_size;
+            check(word(record), word(record + 4));
+        }
+        for (size_t index = 0; index < sitemap_count_; ++index)
+        {
+            size_t record = sitemaps_ + index * sitemap_size;
+            check(word(record), word(record + 4));
+        }
+    }
+
+    bool Snapshot::allowed(const std::string& query, const std::string& name) const
+    {
+        Url::Url url(query);
+        if (!host_.empty() && !url.host().empty() && url.host() != host_)
+        {
+            return false;
+        }
+        std::string path(url.defrag().escape().fullpath());
+
+        if (path.compare("/robots.txt") == 0)
+        {
+            return true;
+        }
+
+        auto matches = [this, &path](size_t record) {
+            const char* expression = data_ + word(record);
+            return Directive::match(expression, expression + word(record + 4),
+                                    path.data(), path.data() + path.size());
+        };
+
+        size_t record = agent(name);
+        size_t begin = directives_ + word(record + 8) * directive_size;
+        size_t end = begin + word(record + 12) * directive_size;
+        for (size_t it = begin; it != end; it += directive_size)
+        {
+            if (matches(it))
+            {
+                if (word(it + 12))
+                {
+                    return true;
+                }
+
+                // An allow with the same priority wins the tie
+                for (size_t other = it + directive_size;
+                     other != end && word(other + 8) == word(it + 8);
+                     other += directive_size)
+                {
+                    if (word(other + 12) && matches(other))
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Agent::delay_t Snapshot::delay(const std::string& name) const
+    {
+        uint32_t bits = word(agent(name) + 16);
+        Agent::delay_t value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::vector<std::string> Snapshot::sitemaps() const
+    {
+        std::vector<std::string> result;
+        for (size_t index = 0; index < sitemap_count_; ++index)
+        {
+            size_t record = sitemaps_ + index * sitemap_size;
+            result.emplace_back(data_ + word(record), word(record + 4));
+        }
+        return result;
+    }
+
+    uint32_t Snapshot::word(size_t offset) const
+    {
+        const unsigned char* bytes =
+            reinterpret_cast<const unsigned char*>(data_ + offset);
+        return static_cast<uint32_t>(bytes[0])
+            | (static_cast<uint32_t>(bytes[1]) << 8)
+            | (static_cast<uint32_t>(bytes[2]) << 16)
+            | (static_cast<uint32_t>(bytes[3]) << 24);
+    }
+
+    size_t Snapshot::agent(const std::string& name) const
+    {
+        std::string lowered(name);
+        std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+
+        // Agents are sorted by name, in the same order as std::string::compare
+        size_t low = 0;
+        size_t high = agent_count_;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            size_t record = agents_ + middle * agent_size;
+            size_t length = word(record + 4);
+            int comparison = std::memcmp(
+                data_ + word(record), lowered.data(), std::min(length, lowered.size()));
+            if (comparison == 0)
+            {
+                if (length == lowered.size())
+                {
+                    return record;
+                }
+                comparison = length < lowered.size() ? -1 : 1;
+            }
+
+            if (comparison < 0)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        return agents_ + default_ * agent_size;
+    }
+
+    void Snapshot::check(size_t offset, size_t length) const
+    {
+        if (offset > size_ || length > size_ - offset)
+        {
+            throw std::invalid_argument("Invalid offset in robots.txt snapshot");
+        }
+    }
+
+    MappedFile::MappedFile(const std::string& path) : data_(nullptr), size_(0)
+    {
+        void* mapped = MAP_FAILED;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd >= 0 && ::fstat(fd, &info) == 0)
+        {
+            size_ = info.st_size;
+            mapped = size_ ? ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0)
+                           : nullptr;
+        }
+        int error = errno;
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        if (mapped == MAP_FAILED)
+        {
+            throw std::system_error(error, std::generic_category(), path);
+        }
+        data_ = static_cast<const char*>(mapped);
+    }
+
+    MappedFile::~MappedFile()
+    {
+        if (data_)
+        {
+            ::munmap(const_cast<char*>(data_), size_);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#include "stats.h"
+
+namespace Rep
+{
+    const size_t Stats::buckets;
+
+    Stats::Stats(size_t directives)
+        : directives_(directives), hits_(new counter_t[directives])
+    {
+        for (auto& counter : outcomes_)
+        {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        for (auto& counter : latencies_)
+        {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        for (size_t index = 0; index < directives_; ++index)
+        {
+            hits_[index].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Stats::record(Outcome outcome, size_t directive, clock_type::duration elapsed)
+    {
+        increment(outcomes_[static_cast<size_t>(outcome)]);
+        if ((outcome == Outcome::allowed || outcome == Outcome::disallowed) &&
+            directive < directives_)
+        {
+            increment(hits_[directive]);
+        }
+
+        // The bucket is the position of the highest bit set
+        uint64_t nanoseconds =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        size_t bucket = 0;
+        while (nanoseconds >>= 1)
+        {
+            ++bucket;
+        }
+        increment(latencies_[bucket < buckets ? bucket : buckets - 1]);
+    }
+
+    uint64_t Stats::checks() const
+    {
+        return allows() + disallows();
+    }
+
+    uint64_t Stats::allows() const
+    {
+        return load(outcomes_[static_cast<size_t>(Outcome::allowed)]) +
+            fallbacks() + robots();
+    }
+
+    uint64_t Stats::disallows() const
+    {
+        return load(outcomes_[static_cast<size_t>(Outcome::disallowed)]);
+    }
+
+    uint64_t Stats::fallbacks() const
+    {
+        return load(outcomes_[static_cast<size_t>(Outcome::fallback)]);
+    }
+
+    uint64_t Stats::robots() const
+    {
+        return load(outcomes_[static_cast<size_t>(Outcome::robots)]);
+    }
+
+    uint64_t Stats::hits(size_t directive) const
+    {
+        return directive < directives_ ? load(hits_[directive]) : 0;
+    }
+
+    uint64_t Stats::latency(size_t bucket) const
+    {
+        return bucket < buckets ? load(latencies_[bucket]) : 0;
+    }
+
+    uint64_t Stats::percentile(double fraction) const
+    {
+        uint64_t counts[buckets];
+        uint64_t total = 0;
+        for (size_t bucket = 0; bucket < buckets; ++bucket)
+        {
+            counts[bucket] = latency(bucket);
+            total += counts[bucket];
+        }
+        if (!total)
+        {
+            return 0;
+        }
+
+        // The first bucket by which the fraction of checks have been seen
+        uint64_t seen = 0;
+        size_t bucket = 0;
+        for (; bucket + 1 < buckets; ++bucket)
+        {
+            seen += counts[bucket];
+            if (seen > 0 && seen >= fraction * total)
+            {
+                break;
+            }
+        }
+        return (static_cast<uint64_t>(1) << (bucket + 1)) - 1;
+    }
+}
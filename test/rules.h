@@ -0,0 +1,183 @@
+#ifndef TEST_RULES_CPP_H
+#define TEST_RULES_CPP_H
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "agent.h"
+#include "automaton.h"
+#include "robots.h"
+
+/**
+ * Helpers shared by the tests that check a faster or leaner way of building or
+ * matching rules against a plainer one, over many random rules and paths.
+ */
+namespace Rules
+{
+    /**
+     * Return the index of the directive that wins by trying each in turn, breaking
+     * ties in favor of an allow.
+     */
+    inline size_t linear(const Rep::Agent::directives_t& directives,
+                         const std::string& path)
+    {
+        size_t best = Rep::Automaton::npos;
+        for (size_t index = 0; index < directives.size(); ++index)
+        {
+            if (!directives[index].match(path))
+            {
+                continue;
+            }
+            if (best == Rep::Automaton::npos)
+            {
+                best = index;
+            }
+            else if (directives[index].priority() > directives[best].priority())
+            {
+                best = index;
+            }
+            else if (directives[index].priority() == directives[best].priority() &&
+                     directives[index].allowed() && !directives[best].allowed())
+            {
+                best = index;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * Put the directives in priority order, as an agent keeps them.
+     */
+    inline void sort(Rep::Agent::directives_t& directives)
+    {
+        std::stable_sort(directives.begin(), directives.end(),
+            [](const Rep::Directive& a, const Rep::Directive& b) {
+                return b.priority() < a.priority();
+            });
+    }
+
+    /**
+     * The empty path, and every path of '/', 'a' and 'b' that starts with '/', of up
+     * to length characters.
+     */
+    inline std::vector<std::string> paths(size_t length)
+    {
+        std::vector<std::string> result = {"", "/"};
+        for (size_t index = 1; result[index].size() < length; ++index)
+        {
+            for (char character : {'/', 'a', 'b'})
+            {
+                result.push_back(result[index] + character);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * A seeded source of random numbers and rules, so that failures reproduce.
+     */
+    class Random
+    {
+    public:
+        Random() : generator_(20161017) {}
+
+        /**
+         * Return a number below bound.
+         */
+        size_t operator()(size_t bound)
+        {
+            return std::uniform_int_distribution<size_t>(0, bound - 1)(generator_);
+        }
+
+        /**
+         * Return start followed by up to most characters, drawn from those that
+         * matter to matching paths of '/', 'a' and 'b'. Rules are mostly short, so
+         * that they often overlap.
+         */
+        std::string rule(const std::string& start, size_t most)
+        {
+            static const char characters[] = "/ab*$";
+            std::string result(start);
+            for (size_t length = (*this)(most + 1); length > 0; --length)
+            {
+                result += characters[(*this)(sizeof(characters) - 1)];
+            }
+            return result;
+        }
+
+        /**
+         * Return a robots.txt of a few groups of the agents "*", "a", "b", "c" and
+         * "d", which often repeat, with disallows of "/0" to "/3" and crawl-delays.
+         */
+        std::string robots()
+        {
+            std::string result;
+            for (size_t group = (*this)(6); group > 0; --group)
+            {
+                for (size_t name = 1 + (*this)(3); name > 0; --name)
+                {
+                    result += "User-agent: " + names()[(*this)(names().size())] + "\n";
+                }
+                for (size_t rule = (*this)(3); rule > 0; --rule)
+                {
+                    result += (*this)(4) ? "Disallow: /" : "Crawl-delay: ";
+                    result += std::to_string((*this)(4)) + "\n";
+                }
+            }
+            return result;
+        }
+
+        /**
+         * Return "*" and some of the other agents of robots().
+         */
+        std::unordered_set<std::string> agents()
+        {
+            std::unordered_set<std::string> result = {"*"};
+            for (const auto& name : names())
+            {
+                if ((*this)(2))
+                {
+                    result.insert(name);
+                }
+            }
+            return result;
+        }
+
+    private:
+        static const std::vector<std::string>& names()
+        {
+            static const std::vector<std::string> result = {"*", "a", "b", "c", "d"};
+            return result;
+        }
+
+        std::mt19937 generator_;
+    };
+
+    /**
+     * Expect the agents of a robots.txt parsed only for some agents to have the same
+     * rules as those of the full parse of its content.
+     */
+    inline void expect_same(const Rep::Robots& full, const Rep::Robots& selected,
+                            const std::unordered_set<std::string>& agents,
+                            const std::string& content)
+    {
+        for (const auto& name : agents)
+        {
+            EXPECT_EQ(full.agent(name).delay(), selected.agent(name).delay())
+                << name << " in\n" << content;
+            for (size_t path = 0; path < 4; ++path)
+            {
+                std::string query = "/" + std::to_string(path);
+                EXPECT_EQ(full.allowed(query, name), selected.allowed(query, name))
+                    << name << " " << query << " in\n" << content;
+            }
+        }
+    }
+}
+
+#endif
@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 
+#include "url.h"
+
 #include "agent.h"
 
+#include "rules.h"
+
 TEST(AgentTest, Basic)
 {
     Rep::Agent agent = Rep::Agent("a.com").allow("/").disallow("/foo");
@@ -136,3 +140,288 @@ TEST(AgentTest, StrWithDelay)
     agent.allow("/bar");
     EXPECT_EQ("Crawl-Delay: 1 [Directive(Disallow: /foo), Directive(Allow: /bar)]", agent.str());
 }
+
+TEST(AgentTest, AllowWinsTie)
+{
+    Rep::Agent agent = Rep::Agent("a.com")
+        .disallow("/path")
+        .allow("/path");
+    EXPECT_TRUE(agent.allowed("/path"));
+    EXPECT_TRUE(agent.compile().allowed("/path"));
+}
+
+TEST(AgentTest, Compiled)
+{
+    Rep::Agent agent = Rep::Agent("a.com")
+        .disallow("/")
+        .allow("/path")
+        .disallow("/path/*.php$")
+        .allow("*/cats")
+        .compile();
+    EXPECT_FALSE(agent.allowed("/"));
+    EXPECT_TRUE(agent.allowed("/path"));
+    EXPECT_FALSE(agent.allowed("/path/index.php"));
+    EXPECT_TRUE(agent.allowed("/path/index.php5"));
+    EXPECT_TRUE(agent.allowed("/cats.html"));
+    EXPECT_TRUE(agent.allowed("/get/more/cats"));
+    EXPECT_TRUE(agent.allowed("/robots.txt"));
+    EXPECT_FALSE(agent.allowed("http://b.com/path"));
+}
+
+TEST(AgentTest, CompiledDefaultsToAllowed)
+{
+    Rep::Agent agent = Rep::Agent("a.com").disallow("/path").compile();
+    EXPECT_TRUE(agent.allowed("/elsewhere"));
+}
+
+TEST(AgentTest, AddingDiscardsCompiled)
+{
+    Rep::Agent agent = Rep::Agent("a.com").disallow("/path").compile();
+    agent.allow("/path/exception");
+    EXPECT_TRUE(agent.allowed("/path/exception"));
+    agent.compile().disallow("/path/exception/no");
+    EXPECT_FALSE(agent.allowed("/path/exception/no"));
+}
+
+TEST(AgentTest, Bucketed)
+{
+    Rep::Agent agent = Rep::Agent("a.com")
+        .disallow("/path/")
+        .allow("/path/exception")
+        .disallow("/*.php$")
+        .bucket();
+    EXPECT_FALSE(agent.allowed("/path/"));
+    EXPECT_TRUE(agent.allowed("/path/exception"));
+    EXPECT_FALSE(agent.allowed("/elsewhere.php"));
+    EXPECT_TRUE(agent.allowed("/elsewhere"));
+    EXPECT_TRUE(agent.allowed("/robots.txt"));
+
+    // Adding a directive discards the buckets
+    size_t usage = agent.memory_usage();
+    agent.allow("/path/again");
+    EXPECT_GT(usage, agent.memory_usage());
+    EXPECT_TRUE(agent.allowed("/path/again"));
+}
+
+TEST(AgentTest, AllowedBatch)
+{
+    Rep::Agent agent = Rep::Agent("a.com")
+        .disallow("/path")
+        .allow("/path/exception");
+    std::vector<std::string> paths = {
+        "/path", "/path/exception", "/elsewhere", "http://b.com/", "/robots.txt",
+        "/path/exception#fragment", "http://a.com/path", ""
+    };
+    std::vector<bool> results(1, false);
+    agent.allowed_batch(paths, results);
+    std::vector<bool> expected = {false, true, true, false, true, true, false, true};
+    EXPECT_EQ(expected, results);
+}
+
+TEST(AgentTest, AllowedPath)
+{
+    Rep::Agent agent = Rep::Agent("a.com")
+        .disallow("/path")
+        .allow("/path/exception")
+        .disallow("/*.php$");
+    EXPECT_FALSE(agent.allowed_path("/path"));
+    EXPECT_TRUE(agent.allowed_path("/path/exception"));
+    EXPECT_FALSE(agent.allowed_path("/index.php"));
+    EXPECT_TRUE(agent.allowed_path("/robots.txt"));
+
+    // The path is taken as-is rather than parsed as a URL
+    EXPECT_TRUE(agent.allowed_path("http://b.com/path"));
+    const char* buffer = "/path/exception";
+    EXPECT_FALSE(agent.allowed_path(buffer, 5));
+
+    agent.compile();
+    EXPECT_FALSE(agent.allowed_path("/path"));
+    EXPECT_TRUE(agent.allowed_path("/path/exception"));
+    EXPECT_FALSE(agent.allowed_path(buffer, 5));
+}
+
+TEST(AgentTest, MemoryUsage)
+{
+    Rep::Agent agent("a.com");
+    size_t empty = agent.memory_usage();
+    EXPECT_LT(sizeof(Rep::Agent), empty);
+
+    agent.disallow("/some/long/path/that/is/not/stored/inline");
+    size_t one = agent.memory_usage();
+    EXPECT_LT(empty + sizeof(Rep::Directive), one);
+
+    // The automaton is included once compiled
+    agent.compile();
+    EXPECT_LT(one, agent.memory_usage());
+
+    // Directives in an arena are left to its owner
+    Rep::Arena arena;
+    Rep::Agent copy(agent, &arena);
+    EXPECT_EQ(sizeof(Rep::Agent) + agent.memory_usage() - one,
+              copy.memory_usage());
+}
+
+TEST(AgentTest, CopiesShareDirectives)
+{
+    Rep::Agent agent = Rep::Agent("a.com").disallow("/path");
+    Rep::Agent copy(agent);
+    EXPECT_EQ(&agent.directives(), &copy.directives());
+
+    // Until either is modified
+    copy.allow("/path/exception");
+    EXPECT_NE(&agent.directives(), &copy.directives());
+    EXPECT_FALSE(agent.allowed("/path/exception"));
+    EXPECT_TRUE(copy.allowed("/path/exception"));
+
+    copy = agent;
+    EXPECT_EQ(&agent.directives(), &copy.directives());
+    agent.allow("/path/other");
+    EXPECT_FALSE(copy.allowed("/path/other"));
+    EXPECT_TRUE(agent.allowed("/path/other"));
+}
+
+TEST(AgentTest, MovedFromRemainsUsable)
+{
+    Rep::Agent agent = Rep::Agent("a.com").disallow("/path");
+    agent.compile();
+    Rep::Agent moved(std::move(agent));
+    EXPECT_FALSE(moved.allowed("/path"));
+    EXPECT_FALSE(agent.allowed("/path"));
+
+    // Adding to either leaves the other unchanged
+    agent.allow("/path/exception");
+    EXPECT_TRUE(agent.allowed("/path/exception"));
+    EXPECT_FALSE(moved.allowed("/path/exception"));
+
+    Rep::Agent assigned;
+    assigned = std::move(moved);
+    moved.allow("/path/other");
+    EXPECT_TRUE(moved.allowed("/path/other"));
+    EXPECT_FALSE(assigned.allowed("/path/other"));
+    EXPECT_FALSE(assigned.allowed("/path"));
+}
+
+TEST(AgentTest, EscapesRules)
+{
+    std::vector<std::pair<std::string, std::string>> rules = {
+        {"/a<d.html", "/a%3Cd.html"},
+        {"/a%3cd.html", "/a%3Cd.html"},
+        {"/%7Emak/%41", "/~mak/A"},
+        {"/caf\xC3\xA9", "/caf%C3%A9"},
+        {"/100%", "/100%25"},
+        {"/%zz", "/%25zz"},
+        {"/path;params?query?more#fragment", "/path;params?query?more"},
+        {"/a?%3fb%2F", "/a??b/"},
+        {"/*.php$", "/*.php$"},
+        {"*/cats", "/*/cats"}
+    };
+    for (const auto& rule : rules)
+    {
+        Rep::Agent agent("a.com");
+        agent.disallow(rule.first);
+        EXPECT_EQ(rule.second, agent.directives().front().expression().c_str())
+            << rule.first;
+    }
+}
+
+TEST(AgentTest, EscapesRulesLikeUrl)
+{
+    // Rules that are plainly paths skip URL parsing, with the same result
+    std::vector<std::string> rules = {
+        "/a<d.html", "/a%3cd.html", "/%7Emak/%41", "/caf\xC3\xA9", "/100%", "/%zz",
+        "/path;params?query?more#fragment", "/a?%3fb%2F", "/*.php$", "/a b/\"c\"",
+        "/%2f%2F%3B%3d%40%5B%5d", "/[brackets]{braces}|pipe^caret`"
+    };
+    for (const auto& rule : rules)
+    {
+        Rep::Agent agent("a.com");
+        agent.disallow(rule);
+        Url::Url url(rule);
+        EXPECT_EQ(url.defrag().escape().fullpath(),
+                  agent.directives().front().expression().c_str()) << rule;
+    }
+}
+
+TEST(AgentTest, MinimizeRemovesRedundant)
+{
+    Rep::Agent agent = Rep::Agent("a.com")
+        .disallow("/a")
+        .disallow("/a/b")
+        .disallow("/a")
+        .disallow("/a/*.php")
+        .disallow("/*.html")
+        .disallow("/b/index.html")
+        .allow("/c")
+        .disallow("/c")
+        .allow("/c/d")
+        .compile();
+    agent.minimize();
+    EXPECT_EQ("[Directive(Disallow: /*.html), Directive(Allow: /c/d), "
+              "Directive(Disallow: /a), Directive(Allow: /c)]", agent.str());
+    EXPECT_FALSE(agent.allowed("/a/b"));
+    EXPECT_FALSE(agent.allowed("/b/index.html"));
+    EXPECT_TRUE(agent.allowed("/c"));
+}
+
+TEST(AgentTest, MinimizeKeepsExceptions)
+{
+    // Each of these rules decides some path differently without the others
+    Rep::Agent agent = Rep::Agent("a.com")
+        .disallow("/a")
+        .allow("/a/b")
+        .disallow("/a/b/c")
+        .disallow("/d")
+        .allow("/d/e")
+        .disallow("/d/e/f$")
+        .allow("/d/e/f/g")
+        .disallow("/x*y")
+        .allow("/x/a/")
+        .disallow("/x/a/y");
+    size_t size = agent.directives().size();
+    EXPECT_EQ(size, agent.minimize().directives().size());
+}
+
+TEST(AgentTest, MinimizeSharedDirectives)
+{
+    Rep::Agent agent = Rep::Agent("a.com").disallow("/a").disallow("/a/b");
+    Rep::Agent copy(agent);
+    copy.minimize();
+    EXPECT_EQ(2ul, agent.directives().size());
+    EXPECT_EQ(1ul, copy.directives().size());
+}
+
+TEST(AgentTest, MinimizeMatchesOriginal)
+{
+    auto paths = Rules::paths(7);
+    Rules::Random random;
+    size_t before = 0;
+    size_t after = 0;
+    for (size_t trial = 0; trial < 1000; ++trial)
+    {
+        Rep::Agent agent("a.com");
+        size_t rules = 1 + random(12);
+        for (size_t rule = 0; rule < rules; ++rule)
+        {
+            std::string query = random.rule(random(4) ? "/" : "*", 4);
+            if (random(2))
+            {
+                agent.allow(query);
+            }
+            else
+            {
+                agent.disallow(random(20) ? query : "");
+            }
+        }
+
+        Rep::Agent minimized(agent);
+        minimized.minimize();
+        before += agent.directives().size();
+        after += minimized.directives().size();
+        for (const auto& path : paths)
+        {
+            ASSERT_EQ(agent.allowed_path(path), minimized.allowed_path(path))
+                << agent.str() << " minimized to " << minimized.str() << " for " << path;
+        }
+    }
+    EXPECT_LT(after, before);
+}
@@ -0,0 +1,82 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "arena.h"
+#include "robots.h"
+
+TEST(ArenaTest, Alignment)
+{
+    Rep::Arena arena(128);
+    arena.allocate(1, 1);
+    void* pointer = arena.allocate(8, 8);
+    EXPECT_EQ(0ul, reinterpret_cast<uintptr_t>(pointer) % 8);
+    EXPECT_EQ(1ul, arena.blocks());
+}
+
+TEST(ArenaTest, Grows)
+{
+    Rep::Arena arena(64);
+    arena.allocate(48, 1);
+    arena.allocate(48, 1);
+    EXPECT_EQ(2ul, arena.blocks());
+    EXPECT_EQ(192ul, arena.capacity());
+
+    // Larger than a block
+    arena.allocate(1000, 1);
+    EXPECT_EQ(3ul, arena.blocks());
+}
+
+TEST(ArenaTest, Allocator)
+{
+    Rep::Arena arena;
+    Rep::ArenaAllocator<int> allocator(&arena);
+    std::vector<int, Rep::ArenaAllocator<int>> values(allocator);
+    values.assign(100, 7);
+    EXPECT_EQ(1ul, arena.blocks());
+    EXPECT_EQ(&arena, values.get_allocator().arena());
+
+    // Copies are never made in the arena
+    std::vector<int, Rep::ArenaAllocator<int>> copy(values);
+    EXPECT_EQ(nullptr, copy.get_allocator().arena());
+    EXPECT_EQ(values, copy);
+    EXPECT_TRUE(copy.get_allocator() != values.get_allocator());
+    EXPECT_TRUE(copy.get_allocator() == Rep::ArenaAllocator<char>());
+}
+
+TEST(ArenaTest, Robots)
+{
+    std::string content =
+        "User-agent: one\n"
+        "User-agent: two\n"
+        "Disallow: /path\n"
+        "Allow: /path/*/exception$\n"
+        "\n"
+        "User-agent: *\n"
+        "Disallow: /tmp\n"
+        "Sitemap: http://a.com/sitemap.xml\n";
+    Rep::Robots::Options options;
+    options.arena = true;
+    Rep::Robots robot(content, "http://a.com/robots.txt", options);
+    Rep::Robots plain(content, "http://a.com/robots.txt");
+    EXPECT_EQ(plain.str(), robot.str());
+    EXPECT_FALSE(robot.allowed("/path/to", "one"));
+    EXPECT_TRUE(robot.allowed("/path/to/exception", "two"));
+    EXPECT_FALSE(robot.allowed("/tmp", "three"));
+    EXPECT_EQ(1ul, robot.sitemaps().size());
+}
+
+TEST(ArenaTest, AgentOutlivesRobots)
+{
+    std::string content =
+        "User-agent: one\n"
+        "Disallow: /a-path-long-enough-to-not-be-inlined\n";
+    Rep::Robots::Options options;
+    options.arena = true;
+    Rep::Agent agent = Rep::Robots(content, "", options).agent("one");
+    EXPECT_FALSE(agent.allowed("/a-path-long-enough-to-not-be-inlined"));
+    EXPECT_EQ(
+        "[Directive(Disallow: /a-path-long-enough-to-not-be-inlined)]", agent.str());
+}
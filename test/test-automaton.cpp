@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include "automaton.h"
+
+#include "rules.h"
+
+TEST(AutomatonTest, Empty)
+{
+    Rep::Agent::directives_t directives;
+    Rep::Automaton automaton(directives);
+    EXPECT_EQ(Rep::Automaton::npos, automaton.match("/"));
+    EXPECT_EQ(Rep::Automaton::npos, automaton.match(""));
+}
+
+TEST(AutomatonTest, LongestLiteral)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/some/path/", false),
+        Rep::Directive("/some/", true),
+    };
+    Rep::Automaton automaton(directives);
+    EXPECT_EQ(0ul, automaton.match("/some/path/page.html"));
+    EXPECT_EQ(1ul, automaton.match("/some/other"));
+    EXPECT_EQ(Rep::Automaton::npos, automaton.match("/some"));
+    EXPECT_EQ(Rep::Automaton::npos, automaton.match("/elsewhere"));
+}
+
+TEST(AutomatonTest, EmptyExpressionMatchesEverything)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/a", false),
+        Rep::Directive("", true),
+    };
+    Rep::Automaton automaton(directives);
+    EXPECT_EQ(0ul, automaton.match("/a"));
+    EXPECT_EQ(1ul, automaton.match("/b"));
+    EXPECT_EQ(1ul, automaton.match(""));
+}
+
+TEST(AutomatonTest, AnchoredLiteral)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/exact$", false),
+        Rep::Directive("/", true),
+    };
+    Rep::Automaton automaton(directives);
+    EXPECT_EQ(0ul, automaton.match("/exact"));
+    EXPECT_EQ(1ul, automaton.match("/exactly"));
+    EXPECT_EQ(1ul, automaton.match("/exa"));
+}
+
+TEST(AutomatonTest, Wildcards)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/this-*-is-a-*-test", false),
+        Rep::Directive("/*.php$", true),
+        Rep::Directive("*/test", true),
+    };
+    Rep::Automaton automaton(directives);
+    EXPECT_EQ(0ul, automaton.match("/this-test-is-another-test-is-a-tricky-test"));
+    EXPECT_EQ(Rep::Automaton::npos, automaton.match("/this-test-is-a-mislead"));
+    EXPECT_EQ(1ul, automaton.match("/folder/filename.php"));
+    EXPECT_EQ(Rep::Automaton::npos, automaton.match("/folder/filename.php5"));
+    EXPECT_EQ(2ul, automaton.match("/abc/test"));
+}
+
+TEST(AutomatonTest, StarDollar)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/fish*$", false),
+    };
+    Rep::Automaton automaton(directives);
+    EXPECT_EQ(0ul, automaton.match("/fish"));
+    EXPECT_EQ(0ul, automaton.match("/fish/salmon.html"));
+    EXPECT_EQ(Rep::Automaton::npos, automaton.match("/fis"));
+}
+
+TEST(AutomatonTest, AllowWinsTie)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/path", false),
+        Rep::Directive("/path", true),
+        Rep::Directive("/p*th", false),
+    };
+    Rep::Automaton automaton(directives);
+    EXPECT_EQ(1ul, automaton.match("/path"));
+}
+
+TEST(AutomatonTest, FirstWinsFullTie)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/a*c", false),
+        Rep::Directive("/ab*", false),
+    };
+    Rep::Automaton automaton(directives);
+    EXPECT_EQ(0ul, automaton.match("/abc"));
+}
+
+TEST(AutomatonTest, MatchesLinearScan)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/", true),
+        Rep::Directive("/a", false),
+        Rep::Directive("/a/b", true),
+        Rep::Directive("/a/b$", false),
+        Rep::Directive("/a*b", false),
+        Rep::Directive("/*b*c", true),
+        Rep::Directive("*/c", false),
+        Rep::Directive("/c", true),
+        Rep::Directive("/*.html$", false),
+        Rep::Directive("/a/*$", true),
+        Rep::Directive("/*a*a*a*b", false),
+    };
+    Rules::sort(directives);
+    Rep::Automaton automaton(directives);
+
+    std::vector<std::string> paths = {
+        "", "/", "/a", "/a/", "/a/b", "/a/b/", "/ab", "/abc", "/b/c", "/c",
+        "/cc", "/x/c", "/index.html", "/index.html?q", "/a/b.html", "/aaab",
+        "/aaaaaaac", "/a/a/a/b", "/b", "/bc", "/xbxcx"
+    };
+    for (const auto& path : paths)
+    {
+        EXPECT_EQ(Rules::linear(directives, path), automaton.match(path)) << path;
+    }
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include "automaton.h"
+#include "buckets.h"
+
+#include "rules.h"
+
+namespace
+{
+    size_t match(const Rep::Buckets& buckets,
+                 const Rep::Agent::directives_t& directives, const std::string& path)
+    {
+        return buckets.match(directives, path.data(), path.size());
+    }
+}
+
+TEST(BucketsTest, Empty)
+{
+    Rep::Agent::directives_t directives;
+    Rep::Buckets buckets(directives);
+    EXPECT_EQ(Rep::Automaton::npos, match(buckets, directives, "/"));
+    EXPECT_EQ(Rep::Automaton::npos, match(buckets, directives, ""));
+}
+
+TEST(BucketsTest, Segments)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/section-10/page", false),
+        Rep::Directive("/section-1/page", true),
+        Rep::Directive("/section-1/", false),
+        Rep::Directive("/section", true),
+    };
+    Rep::Buckets buckets(directives);
+    EXPECT_EQ(0ul, match(buckets, directives, "/section-10/page.html"));
+    EXPECT_EQ(1ul, match(buckets, directives, "/section-1/page.html"));
+    EXPECT_EQ(2ul, match(buckets, directives, "/section-1/other"));
+    EXPECT_EQ(3ul, match(buckets, directives, "/section-1"));
+    EXPECT_EQ(3ul, match(buckets, directives, "/section-2/page"));
+    EXPECT_EQ(Rep::Automaton::npos, match(buckets, directives, "/sect"));
+}
+
+TEST(BucketsTest, WildcardsAlwaysTried)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/a/b/*.php$", true),
+        Rep::Directive("/*.php$", false),
+        Rep::Directive("/a/", true),
+        Rep::Directive("*x", false),
+        Rep::Directive("", true),
+    };
+    Rep::Buckets buckets(directives);
+    EXPECT_EQ(0ul, match(buckets, directives, "/a/b/index.php"));
+    EXPECT_EQ(1ul, match(buckets, directives, "/a/index.php"));
+    EXPECT_EQ(2ul, match(buckets, directives, "/a/index.html"));
+    EXPECT_EQ(3ul, match(buckets, directives, "/x"));
+    EXPECT_EQ(4ul, match(buckets, directives, "/b"));
+    EXPECT_EQ(4ul, match(buckets, directives, ""));
+}
+
+TEST(BucketsTest, AllowWinsTie)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/a*c", false),
+        Rep::Directive("/ab/", false),
+        Rep::Directive("/*b/", true),
+        Rep::Directive("/ab/", false),
+    };
+    Rep::Buckets buckets(directives);
+    EXPECT_EQ(0ul, match(buckets, directives, "/abc"));
+    EXPECT_EQ(2ul, match(buckets, directives, "/ab/"));
+}
+
+TEST(BucketsTest, FirstWinsFullTie)
+{
+    // Even when the later rule is in a bucket that is tried first
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/ab/", false),
+        Rep::Directive("/*b/", false),
+    };
+    Rep::Buckets buckets(directives);
+    EXPECT_EQ(0ul, match(buckets, directives, "/ab/"));
+    EXPECT_EQ(1ul, match(buckets, directives, "/bb/"));
+}
+
+TEST(BucketsTest, MatchesLinearScan)
+{
+    auto paths = Rules::paths(6);
+    Rules::Random random;
+    for (size_t trial = 0; trial < 200; ++trial)
+    {
+        Rep::Agent::directives_t directives;
+        for (size_t rule = 1 + random(20); rule > 0; --rule)
+        {
+            directives.emplace_back(random.rule(random(8) ? "/" : "", 5), random(2));
+        }
+        Rules::sort(directives);
+
+        Rep::Buckets buckets(directives);
+        for (const auto& path : paths)
+        {
+            ASSERT_EQ(Rules::linear(directives, path), match(buckets, directives, path))
+                << path;
+        }
+    }
+}
+
+TEST(BucketsTest, MemoryUsage)
+{
+    Rep::Agent::directives_t directives = {
+        Rep::Directive("/a/", false),
+        Rep::Directive("/b/", false),
+    };
+    Rep::Buckets buckets(directives);
+    EXPECT_LT(sizeof(Rep::Buckets) + 2 * sizeof(size_t), buckets.memory_usage());
+}
@@ -0,0 +1,103 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "bulk.h"
+#include "snapshot.h"
+
+namespace
+{
+    std::vector<Rep::document_t> documents(size_t count)
+    {
+        std::vector<Rep::document_t> result;
+        for (size_t index = 0; index < count; ++index)
+        {
+            std::string number(std::to_string(index));
+            result.emplace_back(
+                "http://site" + number + ".com/robots.txt",
+                "User-agent: *\nDisallow: /" + number + "\n");
+        }
+        return result;
+    }
+}
+
+TEST(BulkTest, ParseMany)
+{
+    std::vector<Rep::document_t> input = documents(1000);
+    Rep::BulkOptions options;
+    options.threads = 4;
+    options.batch = 7;
+    std::vector<Rep::BulkStats> stats;
+    std::vector<std::unique_ptr<Rep::Robots>> result =
+        Rep::parse_many(input, options, &stats);
+    ASSERT_EQ(input.size(), result.size());
+    for (size_t index = 0; index < input.size(); ++index)
+    {
+        std::string path("/" + std::to_string(index));
+        ASSERT_NE(nullptr, result[index]);
+        EXPECT_FALSE(result[index]->allowed(path, "agent"));
+        EXPECT_FALSE(result[index]->allowed("http://b.com/", "agent"));
+        EXPECT_TRUE(result[index]->allowed("/other", "agent"));
+    }
+
+    ASSERT_EQ(4ul, stats.size());
+    size_t parsed = 0;
+    size_t bytes = 0;
+    for (const auto& thread : stats)
+    {
+        parsed += thread.documents;
+        bytes += thread.bytes;
+        EXPECT_EQ(0ul, thread.failures);
+        EXPECT_LE(0.0, thread.seconds);
+    }
+    EXPECT_EQ(input.size(), parsed);
+    size_t expected = 0;
+    for (const auto& document : input)
+    {
+        expected += document.second.size();
+    }
+    EXPECT_EQ(expected, bytes);
+}
+
+TEST(BulkTest, Steals)
+{
+    // A thread that finishes its own share takes work from the others
+    std::vector<Rep::document_t> input = documents(20);
+    input[0].second = std::string(1 << 22, '#');
+    Rep::BulkOptions options;
+    options.threads = 2;
+    options.batch = 1;
+    std::vector<Rep::BulkStats> stats;
+    Rep::parse_many(input, options, &stats);
+    EXPECT_EQ(20ul, stats[0].documents + stats[1].documents);
+    EXPECT_LT(0ul, stats[0].steals + stats[1].steals);
+}
+
+TEST(BulkTest, SerializeMany)
+{
+    std::vector<Rep::document_t> input = documents(10);
+    input[3].first = "http://:::cnn.com/";
+    std::vector<Rep::BulkStats> stats;
+    std::vector<std::string> result = Rep::serialize_many(input, Rep::BulkOptions(), &stats);
+    ASSERT_EQ(input.size(), result.size());
+    EXPECT_TRUE(result[3].empty());
+    size_t failures = 0;
+    for (const auto& thread : stats)
+    {
+        failures += thread.failures;
+    }
+    EXPECT_EQ(1ul, failures);
+
+    Rep::Snapshot snapshot(result[5].data(), result[5].size());
+    EXPECT_FALSE(snapshot.allowed("/5", "agent"));
+    EXPECT_TRUE(snapshot.allowed("/6", "agent"));
+}
+
+TEST(BulkTest, Empty)
+{
+    std::vector<Rep::BulkStats> stats;
+    EXPECT_TRUE(Rep::parse_many({}, Rep::BulkOptions(), &stats).empty());
+    EXPECT_EQ(1ul, stats.size());
+    EXPECT_EQ(0ul, stats[0].documents);
+}
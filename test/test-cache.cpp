@@ -0,0 +1,141 @@
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "cache.h"
+
+namespace
+{
+    typedef Rep::RobotsCache::clock_type clock_type;
+    typedef Rep::RobotsCache::Status Status;
+}
+
+TEST(CacheTest, HitMissStale)
+{
+    Rep::RobotsCache cache(1 << 20, std::chrono::seconds(60));
+    clock_type::time_point now = clock_type::now();
+
+    Rep::RobotsCache::Result result = cache.allowed("http://a.com/path", "agent", now);
+    EXPECT_EQ(Status::miss, result.status);
+    EXPECT_TRUE(result.allowed);
+
+    cache.insert("http://a.com/robots.txt", "User-agent: *\nDisallow: /path\n", now);
+    EXPECT_EQ(1ul, cache.size());
+    result = cache.allowed("http://a.com/path", "agent", now);
+    EXPECT_EQ(Status::hit, result.status);
+    EXPECT_FALSE(result.allowed);
+    result = cache.allowed("http://a.com/other", "agent", now);
+    EXPECT_EQ(Status::hit, result.status);
+    EXPECT_TRUE(result.allowed);
+
+    // Other sites, including other ports, are misses
+    EXPECT_EQ(Status::miss, cache.allowed("http://b.com/path", "agent", now).status);
+    EXPECT_EQ(Status::miss, cache.allowed("http://a.com:8080/path", "agent").status);
+
+    // Expired entries are still used, but reported as stale
+    result = cache.allowed("http://a.com/path", "agent", now + std::chrono::seconds(61));
+    EXPECT_EQ(Status::stale, result.status);
+    EXPECT_FALSE(result.allowed);
+
+    // Until they are replaced
+    cache.insert("http://a.com/", "User-agent: *\nDisallow: /other\n",
+                 now + std::chrono::seconds(61));
+    EXPECT_EQ(1ul, cache.size());
+    result = cache.allowed("http://a.com/path", "agent", now + std::chrono::seconds(62));
+    EXPECT_EQ(Status::hit, result.status);
+    EXPECT_TRUE(result.allowed);
+}
+
+TEST(CacheTest, Find)
+{
+    Rep::RobotsCache cache(1 << 20, std::chrono::seconds(60));
+    auto robots = std::make_shared<const Rep::Robots>("", "http://a.com/robots.txt");
+    cache.insert("http://a.com/", robots, 100);
+    EXPECT_EQ(100ul, cache.usage());
+
+    Status status;
+    EXPECT_EQ(robots, cache.find("http://a.com/some/path", status));
+    EXPECT_EQ(Status::hit, status);
+    EXPECT_EQ(nullptr, cache.find("http://b.com/", status));
+    EXPECT_EQ(Status::miss, status);
+}
+
+TEST(CacheTest, Erase)
+{
+    Rep::RobotsCache cache(1 << 20, std::chrono::seconds(60));
+    std::string content("User-agent: *\nDisallow: /\n");
+    std::string key("http://a.com/robots.txt");
+    cache.insert("http://a.com/", content);
+    // Parsed entries are accounted for by their memory usage
+    EXPECT_EQ(Rep::Robots(content, key).memory_usage() + key.size(), cache.usage());
+    cache.erase("http://a.com/path");
+    cache.erase("http://b.com/");
+    EXPECT_EQ(0ul, cache.size());
+    EXPECT_EQ(0ul, cache.usage());
+    EXPECT_EQ(Status::miss, cache.allowed("http://a.com/", "agent").status);
+}
+
+TEST(CacheTest, Evicts)
+{
+    // One shard, with room for three entries
+    Rep::RobotsCache cache(300, std::chrono::seconds(60), 1);
+    auto robots = std::make_shared<const Rep::Robots>("");
+    cache.insert("http://a.com/", robots, 100);
+    cache.insert("http://b.com/", robots, 100);
+    cache.insert("http://c.com/", robots, 100);
+    EXPECT_EQ(3ul, cache.size());
+
+    // Every entry has been referenced, so the first sweep clears them all, and then
+    // the oldest goes
+    cache.insert("http://d.com/", robots, 100);
+    EXPECT_EQ(3ul, cache.size());
+    EXPECT_EQ(300ul, cache.usage());
+    Status status;
+    EXPECT_EQ(nullptr, cache.find("http://a.com/", status));
+
+    // Recently used entries survive
+    cache.find("http://b.com/", status);
+    cache.insert("http://e.com/", robots, 100);
+    EXPECT_NE(nullptr, cache.find("http://b.com/", status));
+    EXPECT_EQ(nullptr, cache.find("http://c.com/", status));
+    EXPECT_EQ(3ul, cache.size());
+
+    // Freed slots are reused
+    cache.erase("http://b.com/");
+    cache.insert("http://f.com/", robots, 100);
+    EXPECT_EQ(3ul, cache.size());
+
+    // An entry larger than the budget is kept on its own
+    cache.insert("http://g.com/", robots, 1000);
+    EXPECT_EQ(1ul, cache.size());
+    EXPECT_NE(nullptr, cache.find("http://g.com/", status));
+}
+
+TEST(CacheTest, Concurrent)
+{
+    Rep::RobotsCache cache(1 << 20, std::chrono::seconds(60), 4);
+    std::vector<std::thread> threads;
+    for (size_t index = 0; index < 8; ++index)
+    {
+        threads.emplace_back([&cache, index]() {
+            for (size_t site = 0; site < 50; ++site)
+            {
+                std::string url("http://site" + std::to_string(site) + ".com/path");
+                if ((site + index) % 4 == 0)
+                {
+                    cache.insert(url, "User-agent: *\nDisallow: /path\n");
+                }
+                Rep::RobotsCache::Result result = cache.allowed(url, "agent");
+                EXPECT_TRUE(result.status == Status::miss || !result.allowed);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(50ul, cache.size());
+}
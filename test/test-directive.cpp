@@ -121,6 +121,30 @@ TEST(DirectiveTest, MultipleWildcardTest)
     }
 }
 
+TEST(DirectiveTest, StarDollar)
+{
+    Rep::Directive parsed("/fish*$", true);
+    EXPECT_TRUE(parsed.match("/fish"));
+    EXPECT_TRUE(parsed.match("/fish/salmon.html"));
+    EXPECT_FALSE(parsed.match("/fis"));
+}
+
+TEST(DirectiveTest, DollarEndsExpression)
+{
+    Rep::Directive parsed("/fish$.html", true);
+    EXPECT_TRUE(parsed.match("/fish"));
+    EXPECT_FALSE(parsed.match("/fish.html"));
+}
+
+TEST(DirectiveTest, PathologicalWildcards)
+{
+    // A backtracking matcher would try every '*' at every position here
+    Rep::Directive parsed("/*a*a*a*a*a*a*a*a*b", true);
+    std::string path("/" + std::string(10000, 'a'));
+    EXPECT_FALSE(parsed.match(path));
+    EXPECT_TRUE(parsed.match(path + "b"));
+}
+
 TEST(DirectiveTest, Str)
 {
     EXPECT_EQ("Allow: /foo", Rep::Directive("/foo", true).str());
@@ -318,3 +342,71 @@ TEST(GoogleTest, FishStarExtension)
             example << " matched " << directive;
     }
 }
+
+TEST(DirectiveTest, MemoryUsage)
+{
+    Rep::Directive shorter("/foo", true);
+    Rep::Directive longer("/some/long/path/that/is/not/stored/inline", true);
+    EXPECT_LE(sizeof(Rep::Directive), shorter.memory_usage());
+    EXPECT_LT(shorter.memory_usage() + longer.expression().size(),
+              longer.memory_usage());
+
+    // The expression in an arena is accounted for by the arena
+    Rep::Arena arena;
+    Rep::Directive arena_directive(longer, &arena);
+    EXPECT_EQ(sizeof(Rep::Directive), arena_directive.memory_usage());
+}
+
+TEST(DirectiveTest, Kinds)
+{
+    typedef Rep::Directive::Kind Kind;
+    EXPECT_EQ(Kind::prefix, Rep::Directive("", true).kind());
+    EXPECT_EQ(Kind::prefix, Rep::Directive("/path", true).kind());
+    EXPECT_EQ(Kind::prefix, Rep::Directive("/path**", true).kind());
+    EXPECT_EQ(Kind::exact, Rep::Directive("/path$", true).kind());
+    EXPECT_EQ(Kind::infix, Rep::Directive("/path*.html", true).kind());
+    EXPECT_EQ(Kind::infix, Rep::Directive("*.html", true).kind());
+    EXPECT_EQ(Kind::suffix, Rep::Directive("/*.php$", true).kind());
+    EXPECT_EQ(Kind::suffix, Rep::Directive("/path/*$", true).kind());
+    EXPECT_EQ(Kind::general, Rep::Directive("/a*b*c", true).kind());
+    EXPECT_EQ(Kind::general, Rep::Directive("/a$b", true).kind());
+    EXPECT_EQ(Kind::general, Rep::Directive("/a*$b", true).kind());
+
+    Rep::Arena arena;
+    EXPECT_EQ(Kind::suffix, Rep::Directive(Rep::Directive("/*.php$", true), &arena).kind());
+}
+
+TEST(DirectiveTest, Lead)
+{
+    EXPECT_EQ(0ul, Rep::Directive("", true).lead());
+    EXPECT_EQ(0ul, Rep::Directive("*.html", true).lead());
+    EXPECT_EQ(5ul, Rep::Directive("/path", true).lead());
+    EXPECT_EQ(5ul, Rep::Directive("/path$", true).lead());
+    EXPECT_EQ(6ul, Rep::Directive("/path/*.html", true).lead());
+    EXPECT_EQ(2ul, Rep::Directive("/a$b*c", true).lead());
+}
+
+TEST(DirectiveTest, KindsMatchGeneral)
+{
+    // Every kind's kernel agrees with the general matcher
+    std::vector<std::string> expressions = {
+        "", "/", "/a", "/ab", "/a$", "/$", "/ab$", "/a*b", "/*b", "*b", "/a*", "/a*$",
+        "/*$", "/a*b$", "/*ab$", "/a*ba$", "/a*b*a", "/a$b", "$"
+    };
+    std::vector<std::string> paths = {
+        "", "/", "/a", "/b", "/ab", "/ba", "/aab", "/abb", "/aba", "/abab", "/b/a",
+        "/a/b", "/abba"
+    };
+    for (const auto& expression : expressions)
+    {
+        Rep::Directive directive(expression, true);
+        const Rep::Directive::string_t& stored = directive.expression();
+        for (const auto& path : paths)
+        {
+            EXPECT_EQ(
+                Rep::Directive::match(stored.data(), stored.data() + stored.size(),
+                                      path.data(), path.data() + path.size()),
+                directive.match(path)) << expression << " " << path;
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "index.h"
+
+TEST(IndexTest, Insert)
+{
+    Rep::RobotsIndex index("My-Agent");
+    EXPECT_EQ(0ul, index.size());
+    index.insert("http://a.com/some/page", "User-agent: my-agent\nDisallow: /a\n");
+    index.insert("http://b.com/", Rep::Robots("User-agent: *\nDisallow: /b\n"));
+    EXPECT_EQ(2ul, index.size());
+    EXPECT_TRUE(index.contains("http://a.com/other"));
+    EXPECT_TRUE(index.contains("http://B.com"));
+    EXPECT_FALSE(index.contains("http://c.com/"));
+    EXPECT_FALSE(index.contains("/path"));
+
+    EXPECT_FALSE(index.allowed("http://a.com/a"));
+    EXPECT_TRUE(index.allowed("http://a.com/b"));
+    EXPECT_FALSE(index.allowed("http://b.com/b"));
+    EXPECT_TRUE(index.allowed("http://b.com/a"));
+
+    // Inserting again replaces the rules
+    index.insert("http://a.com:80/", "User-agent: *\nDisallow: /b\n");
+    EXPECT_EQ(2ul, index.size());
+    EXPECT_TRUE(index.allowed("http://a.com/a"));
+    EXPECT_FALSE(index.allowed("http://a.com/b"));
+
+    index.erase("http://a.com/anything");
+    EXPECT_EQ(1ul, index.size());
+    EXPECT_FALSE(index.contains("http://a.com/"));
+}
+
+TEST(IndexTest, Missing)
+{
+    Rep::RobotsIndex allowing("agent");
+    EXPECT_TRUE(allowing.allowed("http://a.com/a"));
+    Rep::RobotsIndex disallowing("agent", false);
+    EXPECT_FALSE(disallowing.allowed("http://a.com/a"));
+    EXPECT_FALSE(disallowing.allowed("/a"));
+    EXPECT_FALSE(disallowing.allowed("http://:::cnn.com/"));
+}
+
+TEST(IndexTest, Paths)
+{
+    Rep::RobotsIndex index("agent");
+    index.insert("http://a.com/",
+        "User-agent: *\nDisallow: /\nAllow: /$\nAllow: /page?q=1\nAllow: /a%3cb\n");
+    // An empty path is the root
+    EXPECT_TRUE(index.allowed("http://a.com"));
+    EXPECT_TRUE(index.allowed("http://a.com/#fragment"));
+    EXPECT_TRUE(index.allowed("http://a.com/page?q=1#fragment"));
+    EXPECT_FALSE(index.allowed("http://a.com/page?q=2"));
+    EXPECT_TRUE(index.allowed("http://a.com/a%3Cb"));
+    EXPECT_FALSE(index.allowed("http://a.com//a"));
+}
+
+TEST(IndexTest, AllowedBatch)
+{
+    Rep::RobotsIndex index("agent", false);
+    index.insert("http://a.com/", "User-agent: *\nDisallow: /a\n");
+    index.insert("https://b.com/", "User-agent: *\nDisallow: /b\n");
+
+    // Interleaved sites are checked by site, but reported in order
+    std::vector<std::string> urls = {
+        "http://a.com/a", "https://b.com/a", "http://a.com/b", "https://b.com/b",
+        "http://c.com/a", "http://A.com/a", "https://b.com:443/b", "https://b.com"
+    };
+    std::vector<bool> results;
+    index.allowed_batch(urls, results);
+    std::vector<bool> expected = {false, true, true, false, false, false, false, true};
+    EXPECT_EQ(expected, results);
+    for (size_t position = 0; position < urls.size(); ++position)
+    {
+        EXPECT_EQ(index.allowed(urls[position]), results[position]) << urls[position];
+    }
+
+    index.allowed_batch(std::vector<std::string>(), results);
+    EXPECT_TRUE(results.empty());
+}
+
+TEST(IndexTest, MemoryUsage)
+{
+    Rep::RobotsIndex index("agent");
+    size_t empty = index.memory_usage();
+    index.insert("http://a.com/", "User-agent: *\nDisallow: /a\n");
+    EXPECT_LT(empty, index.memory_usage());
+}
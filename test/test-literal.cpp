@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "literal.h"
+
+TEST(LiteralTest, Equal)
+{
+    std::string lhs("/some/long/path/that/spans/several/blocks");
+    std::string rhs(lhs);
+    EXPECT_TRUE(Rep::Literal::equal(lhs.data(), rhs.data(), lhs.size()));
+    EXPECT_TRUE(Rep::Literal::equal(lhs.data(), rhs.data(), 0));
+
+    // Differences in a full block and in the tail
+    rhs[3] = 'x';
+    EXPECT_FALSE(Rep::Literal::equal(lhs.data(), rhs.data(), lhs.size()));
+    rhs = lhs;
+    rhs[rhs.size() - 1] = 'x';
+    EXPECT_FALSE(Rep::Literal::equal(lhs.data(), rhs.data(), lhs.size()));
+    EXPECT_TRUE(Rep::Literal::equal(lhs.data(), rhs.data(), lhs.size() - 1));
+}
+
+TEST(LiteralTest, Search)
+{
+    std::string haystack("/path/with/a/needle/and/another/needle");
+    const char* begin = haystack.data();
+    const char* end = begin + haystack.size();
+    EXPECT_EQ(begin + 13, Rep::Literal::search(begin, end, "needle", 6));
+    EXPECT_EQ(begin + 1, Rep::Literal::search(begin, end, "p", 1));
+    EXPECT_EQ(begin, Rep::Literal::search(begin, end, "", 0));
+    EXPECT_EQ(end, Rep::Literal::search(begin, end, "missing", 7));
+    EXPECT_EQ(end, Rep::Literal::search(begin, end, "z", 1));
+    EXPECT_EQ(begin + 3, Rep::Literal::search(begin + 3, begin + 3, "", 0));
+    EXPECT_EQ(begin + 3, Rep::Literal::search(begin, begin + 3, "pat", 3));
+}
+
+TEST(LiteralTest, SearchMatchesStd)
+{
+    // Every needle drawn from a haystack long enough to reach the vectorized loops,
+    // along with near misses, found where std::search finds it
+    std::string haystack;
+    for (size_t index = 0; index < 200; ++index)
+    {
+        haystack.push_back("ab/c"[(index * 7 + index / 3) % 4]);
+    }
+    const char* begin = haystack.data();
+    const char* end = begin + haystack.size();
+    for (size_t start = 0; start < haystack.size(); start += 13)
+    {
+        for (size_t length = 1; length < 40 && start + length <= haystack.size(); ++length)
+        {
+            std::string needle(haystack, start, length);
+            for (size_t variant = 0; variant < 2; ++variant)
+            {
+                if (variant)
+                {
+                    needle[length / 2] = 'x';
+                }
+                const char* expected = std::search(
+                    begin, end, needle.data(), needle.data() + needle.size());
+                EXPECT_EQ(expected, Rep::Literal::search(
+                    begin, end, needle.data(), needle.size()))
+                    << "needle " << needle;
+            }
+        }
+    }
+}
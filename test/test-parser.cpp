@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "parser.h"
+#include "robots.h"
+
+#include "rules.h"
+
+namespace
+{
+    const std::string content =
+        "\xEF\xBB\xBF# comment\n"
+        "User-agent: one\r\n"
+        "User-agent: two\n"
+        "Disallow: /tmp # trailing comment\n"
+        "Crawl-delay: 2\n"
+        "\n"
+        "User-agent: *\n"
+        "Disallow: /private\n"
+        "Allow: /private/*/public$\n"
+        "Sitemap: http://a.com/sitemap.xml\n"
+        "Disallow: /last";
+
+    const std::vector<std::string> paths = {
+        "/", "/tmp", "/private", "/private/x/public", "/last", "/lastly"
+    };
+
+    /**
+     * Parse the content in chunks of the given size.
+     */
+    Rep::Robots chunked(const std::string& data, size_t size,
+                        size_t budget = Rep::RobotsParser::unlimited,
+                        const Rep::Robots::Options& options = Rep::Robots::Options())
+    {
+        Rep::RobotsParser parser("http://a.com/robots.txt", options, budget);
+        for (size_t offset = 0; offset < data.size(); offset += size)
+        {
+            parser.feed(data.data() + offset, std::min(size, data.size() - offset));
+        }
+        return parser.finish();
+    }
+}
+
+TEST(ParserTest, MatchesRobots)
+{
+    Rep::Robots expected(content, "http://a.com/robots.txt");
+    for (size_t size = 1; size <= content.size(); ++size)
+    {
+        Rep::Robots robots = chunked(content, size);
+        EXPECT_EQ(expected.str(), robots.str()) << size;
+        EXPECT_EQ(expected.sitemaps(), robots.sitemaps()) << size;
+        EXPECT_EQ(2, robots.agent("two").delay()) << size;
+        for (const auto& path : paths)
+        {
+            for (const auto& agent : {"one", "two", "other"})
+            {
+                EXPECT_EQ(expected.allowed(path, agent), robots.allowed(path, agent))
+                    << size << " " << agent << " " << path;
+            }
+        }
+    }
+}
+
+TEST(ParserTest, Empty)
+{
+    Rep::RobotsParser parser("");
+    EXPECT_TRUE(parser.feed("", 0));
+    Rep::Robots robots = parser.finish();
+    EXPECT_TRUE(robots.allowed("/", "agent"));
+    EXPECT_EQ(0ul, parser.consumed());
+}
+
+TEST(ParserTest, Budget)
+{
+    std::string data =
+        "User-agent: *\n"
+        "Disallow: /first\n"
+        "Disallow: /second\n";
+    Rep::RobotsParser parser("", Rep::Robots::Options(), 44);
+    EXPECT_TRUE(parser.feed(data.data(), 20));
+    EXPECT_FALSE(parser.feed(data.data() + 20, data.size() - 20));
+    EXPECT_FALSE(parser.feed(data.data(), data.size()));
+    EXPECT_TRUE(parser.truncated());
+    EXPECT_EQ(44ul, parser.consumed());
+
+    // Content is parsed as though it ended at the budget, mid-line
+    Rep::Robots robots = parser.finish();
+    EXPECT_FALSE(robots.allowed("/first", "agent"));
+    EXPECT_FALSE(robots.allowed("/sex", "agent"));
+    EXPECT_TRUE(robots.allowed("/s", "agent"));
+    EXPECT_FALSE(chunked(data, 7, 44).allowed("/sex", "agent"));
+    EXPECT_TRUE(chunked(data, 7).allowed("/sex", "agent"));
+}
+
+TEST(ParserTest, Options)
+{
+    Rep::Robots::Options options;
+    options.arena = true;
+    Rep::RobotsParser parser("", options);
+    parser.feed(content.data(), content.size());
+    Rep::Robots robots = parser.finish();
+    EXPECT_FALSE(robots.allowed("/tmp", "one"));
+    EXPECT_TRUE(robots.allowed("/tmp", "other"));
+}
+
+TEST(ParserTest, SelectedAgentsMatchFullParse)
+{
+    // Even when a wanted agent turns out to share the rules of a skipped one
+    Rules::Random random;
+    for (size_t trial = 0; trial < 1000; ++trial)
+    {
+        std::string content = random.robots();
+        Rep::Robots::Options options;
+        options.agents = random.agents();
+        options.lazy = random(2);
+        options.arena = random(2);
+        Rep::Robots streamed = chunked(content, 1 + random(16),
+                                       Rep::RobotsParser::unlimited, options);
+        Rules::expect_same(Rep::Robots(content), streamed, options.agents, content);
+    }
+}
+
+TEST(ParserTest, Lazy)
+{
+    // Deferred rules are kept past the chunks they arrived in
+    Rep::Robots::Options options;
+    options.lazy = true;
+    Rep::RobotsParser parser("", options);
+    for (size_t offset = 0; offset < content.size(); offset += 5)
+    {
+        std::string chunk(content.substr(offset, 5));
+        parser.feed(chunk.data(), chunk.size());
+    }
+    Rep::Robots robots = parser.finish();
+    EXPECT_EQ(Rep::Robots(content).str(), robots.str());
+}
@@ -0,0 +1,91 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "pool.h"
+#include "robots.h"
+
+TEST(PoolTest, SharesIdenticalRules)
+{
+    Rep::RulePool pool;
+    Rep::Robots::Options options;
+    options.pool = &pool;
+    std::string content =
+        "User-agent: agent\n"
+        "Disallow: /private\n"
+        "Allow: /private/*/public\n"
+        "User-agent: *\n"
+        "Disallow: /private\n"
+        "Allow: /private/*/public\n";
+    Rep::Robots first(content, "http://a.com/robots.txt", options);
+    Rep::Robots second(content, "http://b.com/robots.txt", options);
+    EXPECT_EQ(&first.agent("*").directives(), &second.agent("*").directives());
+    EXPECT_EQ(&first.agent("agent").directives(), &first.agent("*").directives());
+    EXPECT_EQ(1ul, pool.size());
+
+    // Rules are still checked against each site's own host
+    EXPECT_FALSE(first.allowed("http://a.com/private", "agent"));
+    EXPECT_FALSE(first.allowed("http://b.com/public", "agent"));
+    EXPECT_TRUE(second.allowed("http://b.com/private/x/public", "agent"));
+
+    Rep::Robots other("User-agent: *\nDisallow: /private\n", "http://c.com/", options);
+    EXPECT_NE(&first.agent("*").directives(), &other.agent("*").directives());
+    EXPECT_EQ(2ul, pool.size());
+
+    // The verdict is part of the rules
+    Rep::Robots allowed("User-agent: *\nAllow: /private\n", "http://d.com/", options);
+    EXPECT_NE(&allowed.agent("*").directives(), &other.agent("*").directives());
+    EXPECT_EQ(3ul, pool.size());
+}
+
+TEST(PoolTest, Arena)
+{
+    Rep::RulePool pool;
+    Rep::Robots::Options options;
+    options.pool = &pool;
+    options.arena = true;
+    std::string content = "User-agent: *\nDisallow: /private\n";
+    std::unique_ptr<Rep::Robots> first(new Rep::Robots(content, "", options));
+    Rep::Robots second(content, "", options);
+    EXPECT_EQ(&first->agent("*").directives(), &second.agent("*").directives());
+
+    // Interned rules are on the heap, so they outlive the arena
+    first.reset();
+    EXPECT_FALSE(second.allowed("/private", "agent"));
+    EXPECT_EQ(1ul, pool.size());
+}
+
+TEST(PoolTest, ModifyingDoesNotAffectOthers)
+{
+    Rep::RulePool pool;
+    Rep::Robots::Options options;
+    options.pool = &pool;
+    std::string content = "User-agent: *\nDisallow: /private\n";
+    Rep::Robots robots(content, "", options);
+    Rep::Agent agent = robots.agent("*");
+    pool.intern(agent);
+    EXPECT_EQ(&robots.agent("*").directives(), &agent.directives());
+
+    agent.allow("/private/public");
+    EXPECT_NE(&robots.agent("*").directives(), &agent.directives());
+    EXPECT_EQ(1ul, robots.agent("*").directives().size());
+    EXPECT_TRUE(agent.allowed("/private/public"));
+    EXPECT_FALSE(robots.allowed("/private/public", "agent"));
+}
+
+TEST(PoolTest, ReleasesUnusedRules)
+{
+    Rep::RulePool pool;
+    Rep::Robots::Options options;
+    options.pool = &pool;
+    Rep::Robots kept("User-agent: *\nDisallow: /kept\n", "", options);
+    for (size_t index = 0; index < 200; ++index)
+    {
+        std::string content("User-agent: *\nDisallow: /" + std::to_string(index) + "\n");
+        Rep::Robots robots(content, "", options);
+    }
+    EXPECT_EQ(1ul, pool.size());
+    EXPECT_FALSE(kept.allowed("/kept", "agent"));
+}
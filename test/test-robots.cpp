@@ -1,9 +1,15 @@
+#include <thread>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 #include "url.h"
 
+#include "pool.h"
 #include "robots.h"
 
+#include "rules.h"
+
 TEST(RobotsTest, NoLeadingUserAgent)
 {
     // Assumed to be the default user agent
@@ -72,6 +78,47 @@ TEST(RobotsTest, Grouping)
     EXPECT_FALSE(robot.allowed("/tmp", "two"));
 }
 
+TEST(RobotsTest, GroupingSharesAgent)
+{
+    std::string content =
+        "User-agent: one\n"
+        "User-agent: two\n"
+        "User-agent: three\n"
+        "Disallow: /tmp\n"
+        "Crawl-delay: 2\n";
+    Rep::Robots robot(content);
+    EXPECT_EQ(&robot.agent("one"), &robot.agent("two"));
+    EXPECT_EQ(&robot.agent("one"), &robot.agent("three"));
+    EXPECT_EQ(2, robot.agent("three").delay());
+}
+
+TEST(RobotsTest, GroupingReopened)
+{
+    // Names that share a group's rules and then start groups of their own only add
+    // those rules to themselves
+    std::string content =
+        "User-agent: one\n"
+        "User-agent: two\n"
+        "User-agent: three\n"
+        "Disallow: /tmp\n"
+        "User-agent: two\n"
+        "Disallow: /two\n"
+        "User-agent: one\n"
+        "Disallow: /one\n";
+    Rep::Robots robot(content);
+    EXPECT_FALSE(robot.allowed("/tmp", "one"));
+    EXPECT_FALSE(robot.allowed("/tmp", "two"));
+    EXPECT_FALSE(robot.allowed("/tmp", "three"));
+    EXPECT_FALSE(robot.allowed("/one", "one"));
+    EXPECT_TRUE(robot.allowed("/one", "two"));
+    EXPECT_TRUE(robot.allowed("/one", "three"));
+    EXPECT_FALSE(robot.allowed("/two", "two"));
+    EXPECT_TRUE(robot.allowed("/two", "one"));
+    EXPECT_TRUE(robot.allowed("/two", "three"));
+    EXPECT_NE(&robot.agent("one"), &robot.agent("two"));
+    EXPECT_NE(&robot.agent("one"), &robot.agent("three"));
+}
+
 TEST(RobotsTest, GroupingUnknownKeys)
 {
     // When we encounter unknown keys, we should disregard any grouping that may have
@@ -355,3 +402,504 @@ TEST(RobotsTest, LeadingWildcardDisallow)
     EXPECT_FALSE(robot.allowed("/heaps/of/kangaroos/page.html", "meow"));
     EXPECT_FALSE(robot.allowed("/kangaroosandkoalas/page.html", "meow"));
 }
+
+TEST(RobotsTest, Buffer)
+{
+    std::string content =
+        "User-agent: agent\n"
+        "Disallow: /path\n"
+        "User-agent: other\n"
+        "Disallow: /other\n";
+    // Only the first group is within the provided length
+    Rep::Robots robot(content.data(), 34, "http://a.com/robots.txt");
+    EXPECT_FALSE(robot.allowed("/path", "agent"));
+    EXPECT_TRUE(robot.allowed("/other", "other"));
+}
+
+TEST(RobotsTest, CarriageReturns)
+{
+    std::string content =
+        "User-agent: agent\r\n"
+        "Disallow: /path\r\n"
+        "Sitemap: http://a.com/sitemap.xml\r\n";
+    Rep::Robots robot(content);
+    EXPECT_FALSE(robot.allowed("/path", "agent"));
+    EXPECT_TRUE(robot.allowed("/path2", "other"));
+    std::vector<std::string> expected = {"http://a.com/sitemap.xml"};
+    EXPECT_EQ(robot.sitemaps(), expected);
+}
+
+TEST(RobotsTest, KeyCaseAndWhitespace)
+{
+    std::string content =
+        "  USER-AGENT :\tAgent  \n"
+        "\tDISALLOW:/path   # trailing comment\n"
+        "   \n"
+        "Disallowed: /other";
+    Rep::Robots robot(content);
+    EXPECT_FALSE(robot.allowed("/path", "agent"));
+    EXPECT_TRUE(robot.allowed("/other", "agent"));
+}
+
+TEST(RobotsTest, AllowedBatch)
+{
+    std::string content =
+        "User-agent: agent\n"
+        "Disallow: /path\n"
+        "User-agent: *\n"
+        "Disallow: /\n";
+    Rep::Robots robot(content);
+    std::vector<std::string> paths = {"/path", "/other", "/robots.txt"};
+    std::vector<bool> results;
+
+    robot.allowed_batch(paths, "Agent", results);
+    std::vector<bool> expected = {false, true, true};
+    EXPECT_EQ(expected, results);
+
+    robot.allowed_batch(paths, "other", results);
+    expected = {false, false, true};
+    EXPECT_EQ(expected, results);
+}
+
+TEST(RobotsTest, ResolvedAgent)
+{
+    std::string content =
+        "User-agent: agent\n"
+        "Disallow: /path\n"
+        "User-agent: *\n"
+        "Disallow: /\n";
+    Rep::Robots robot(content);
+    Rep::Robots::AgentRef agent = robot.resolve("AGENT");
+    Rep::Robots::AgentRef other = robot.resolve("other");
+    EXPECT_EQ(&robot.agent("agent"), &agent.agent());
+    EXPECT_EQ(&robot.agent("other"), &other.agent());
+
+    EXPECT_FALSE(robot.allowed("/path", agent));
+    EXPECT_TRUE(robot.allowed("/other", agent));
+    EXPECT_FALSE(robot.allowed("/other", other));
+
+    // Handles are cheap to copy
+    Rep::Robots::AgentRef copy(other);
+    other = agent;
+    EXPECT_TRUE(robot.allowed("/other", other));
+    EXPECT_FALSE(robot.allowed("/other", copy));
+
+    std::vector<bool> results;
+    robot.allowed_batch({"/path", "/other"}, agent, results);
+    std::vector<bool> expected = {false, true};
+    EXPECT_EQ(expected, results);
+}
+
+TEST(RobotsTest, ConcurrentChecks)
+{
+    // Freshly built agents, compiled or not, are checked from many threads at once.
+    // Run under ThreadSanitizer with `make tsan`.
+    std::string content =
+        "User-agent: agent\n"
+        "Allow: /path/*.html$\n"
+        "Disallow: /path\n"
+        "Allow: /\n"
+        "User-agent: *\n"
+        "Disallow: /private\n"
+        "Allow: /private/*/public\n";
+    Rep::Robots robot(content, "http://a.com/robots.txt");
+    Rep::Agent compiled = Rep::Agent(robot.agent("agent")).compile();
+    std::vector<std::string> paths;
+    for (size_t index = 0; index < 100; ++index)
+    {
+        std::string number(std::to_string(index));
+        paths.push_back("/path/" + number + ".html");
+        paths.push_back("/path/" + number + ".php");
+        paths.push_back("/private/" + number + "/public");
+        paths.push_back("/private/" + number);
+    }
+
+    std::vector<std::vector<bool>> results(8);
+    std::vector<std::thread> threads;
+    for (size_t index = 0; index < results.size(); ++index)
+    {
+        threads.emplace_back([&robot, &compiled, &paths, &results, index]() {
+            for (size_t round = 0; round < 10; ++round)
+            {
+                results[index].clear();
+                for (const auto& path : paths)
+                {
+                    results[index].push_back(robot.allowed(path, "agent"));
+                    results[index].push_back(robot.allowed(path, "other"));
+                    results[index].push_back(compiled.allowed(path));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    std::vector<bool> expected;
+    for (const auto& path : paths)
+    {
+        expected.push_back(robot.allowed(path, "agent"));
+        expected.push_back(robot.allowed(path, "other"));
+        expected.push_back(compiled.allowed(path));
+    }
+    EXPECT_FALSE(expected[3]);
+    EXPECT_TRUE(expected[6]);
+    EXPECT_FALSE(expected[10]);
+    for (const auto& result : results)
+    {
+        EXPECT_EQ(expected, result);
+    }
+}
+
+TEST(RobotsTest, SelectedAgents)
+{
+    std::string content =
+        "User-agent: other\n"
+        "Disallow: /other\n"
+        "Crawl-delay: 5\n"
+        "User-agent: skipped\n"
+        "User-agent: Agent\n"
+        "Disallow: /agent\n"
+        "User-agent: later\n"
+        "Disallow: /later\n"
+        "Sitemap: http://a.com/sitemap.xml\n"
+        "User-agent: *\n"
+        "Disallow: /default\n";
+    Rep::Robots::Options options;
+    options.agents = {"AGENT", "later"};
+    Rep::Robots robot(content, "", options);
+    EXPECT_FALSE(robot.allowed("/agent", "agent"));
+    EXPECT_TRUE(robot.allowed("/default", "agent"));
+    EXPECT_FALSE(robot.allowed("/later", "later"));
+
+    // Other agents fall back to the default rules
+    EXPECT_TRUE(robot.allowed("/other", "other"));
+    EXPECT_FALSE(robot.allowed("/default", "other"));
+    EXPECT_FALSE(robot.allowed("/default", "skipped"));
+    EXPECT_EQ(-1, robot.agent("other").delay());
+    EXPECT_EQ(&robot.agent("*"), &robot.agent("skipped"));
+    EXPECT_EQ(1ul, robot.sitemaps().size());
+}
+
+TEST(RobotsTest, SelectedAgentsAfterSkippedName)
+{
+    // A name that is already bound keeps its agent, as it does in a full parse
+    std::string content =
+        "User-agent: *\n"
+        "User-agent: me\n"
+        "Disallow: /x\n"
+        "User-agent: other\n"
+        "User-agent: *\n"
+        "User-agent: me\n"
+        "Disallow: /b\n";
+    Rep::Robots::Options options;
+    options.agents = {"me"};
+    Rep::Robots robot(content, "", options);
+    EXPECT_FALSE(robot.allowed("/x", "*"));
+    EXPECT_TRUE(robot.allowed("/b", "*"));
+    EXPECT_FALSE(robot.allowed("/x", "me"));
+    EXPECT_TRUE(robot.allowed("/b", "me"));
+
+    // A name that is not yet bound gets the skipped agent's earlier rules too
+    content =
+        "User-agent: other\n"
+        "Disallow: /a\n"
+        "User-agent: other\n"
+        "User-agent: me\n"
+        "Disallow: /b\n";
+    Rep::Robots later(content, "", options);
+    EXPECT_FALSE(later.allowed("/a", "me"));
+    EXPECT_FALSE(later.allowed("/b", "me"));
+}
+
+TEST(RobotsTest, SelectedAgentsMatchFullParse)
+{
+    Rules::Random random;
+    for (size_t trial = 0; trial < 1000; ++trial)
+    {
+        std::string content = random.robots();
+        Rep::Robots::Options options;
+        options.agents = random.agents();
+        options.lazy = random(2);
+        options.arena = random(2);
+        Rep::Robots selected(content, "", options);
+        Rules::expect_same(Rep::Robots(content), selected, options.agents, content);
+    }
+}
+
+TEST(RobotsTest, MemoryUsage)
+{
+    std::string content =
+        "User-agent: one\n"
+        "User-agent: two\n"
+        "Disallow: /some/long/path/that/is/not/stored/inline\n"
+        "Sitemap: http://a.com/some/long/sitemap/url/sitemap.xml\n";
+    Rep::Robots robot(content);
+    size_t usage = robot.memory_usage();
+    EXPECT_LT(sizeof(Rep::Robots) + robot.agent("one").memory_usage(), usage);
+
+    // More rules use more memory
+    EXPECT_LT(usage, Rep::Robots(content + "Disallow: /more\n").memory_usage());
+
+    // With an arena, its whole capacity is counted
+    Rep::Robots::Options options;
+    options.arena = true;
+    Rep::Robots arena(content, "", options);
+    EXPECT_LT(content.size(), arena.memory_usage());
+
+    // But not for copies, which are on the heap
+    Rep::Robots copy(arena);
+    EXPECT_EQ(usage, copy.memory_usage());
+}
+
+TEST(RobotsTest, Minimize)
+{
+    std::string content =
+        "User-agent: *\n"
+        "Disallow: /a\n"
+        "Disallow: /a/\n"
+        "Allow: /a/b\n"
+        "Allow: /a/b/c\n";
+    Rep::Robots::Options options;
+    options.minimize = true;
+    Rep::Robots robot(content, "", options);
+    EXPECT_EQ("[Directive(Allow: /a/b), Directive(Disallow: /a)]",
+              robot.agent("agent").str());
+    EXPECT_TRUE(robot.allowed("/a/b/c", "agent"));
+    EXPECT_FALSE(robot.allowed("/a/c", "agent"));
+}
+
+TEST(RobotsTest, ManyDirectives)
+{
+    // Agents with many directives are bucketed, with the same results
+    std::string content = "User-agent: *\n";
+    for (size_t section = 0; section < 20; ++section)
+    {
+        std::string prefix = "/section-" + std::to_string(section) + "/";
+        content += "Disallow: " + prefix + "\nAllow: " + prefix + "*.html$\n";
+    }
+    Rep::Robots::Options lazy;
+    lazy.lazy = true;
+    for (const auto& options : {Rep::Robots::Options(), lazy})
+    {
+        Rep::Robots robot(content, "", options);
+        EXPECT_FALSE(robot.allowed("/section-5/", "agent"));
+        EXPECT_TRUE(robot.allowed("/section-5/page.html", "agent"));
+        EXPECT_FALSE(robot.allowed("/section-15/page.php", "agent"));
+        EXPECT_TRUE(robot.allowed("/section-20/", "agent"));
+
+        Rep::Agent agent = robot.agent("agent");
+        size_t usage = agent.memory_usage();
+        agent.allow("/other");
+        EXPECT_GT(usage, agent.memory_usage());
+    }
+}
+
+TEST(RobotsTest, DirectivesInPriorityOrder)
+{
+    // Directives are sorted once parsed, keeping ties in the order they were listed
+    std::string content =
+        "User-agent: one\n"
+        "User-agent: two\n"
+        "Disallow: /a\n"
+        "Allow: /bb\n"
+        "Disallow: /b\n"
+        "User-agent: one\n"
+        "Crawl-delay: 1\n"
+        "User-agent: two\n"
+        "Allow: /c\n"
+        "Disallow: /ccc\n";
+    Rep::Agent one;
+    one.disallow("/a").allow("/bb").disallow("/b");
+    Rep::Agent two(one);
+    two.allow("/c").disallow("/ccc");
+    one.delay(1);
+
+    Rep::Robots::Options lazy;
+    lazy.lazy = true;
+    for (const auto& options : {Rep::Robots::Options(), lazy})
+    {
+        Rep::Robots robot(content, "", options);
+        EXPECT_EQ(one.str(), robot.agent("one").str());
+        EXPECT_EQ(two.str(), robot.agent("two").str());
+
+        // Directives added later are still inserted in priority order
+        Rep::Agent agent = robot.agent("two");
+        Rep::Agent expected(two);
+        agent.allow("/dd");
+        expected.allow("/dd");
+        EXPECT_EQ(expected.str(), agent.str());
+    }
+}
+
+TEST(RobotsTest, Copy)
+{
+    std::string content = "User-agent: one\nDisallow: /one\n";
+    Rep::Robots robot(content);
+    Rep::Robots copy(robot);
+    EXPECT_FALSE(copy.allowed("/one", "one"));
+    EXPECT_NE(&robot.agent("one"), &copy.agent("one"));
+
+    Rep::Robots assigned("");
+    assigned = robot;
+    EXPECT_FALSE(assigned.allowed("/one", "one"));
+    EXPECT_EQ(robot.str(), assigned.str());
+}
+
+TEST(RobotsTest, ArenaAssignment)
+{
+    // The agents and names of the arena-backed Robots assigned onto are released
+    // before its arena
+    Rep::Robots::Options options;
+    options.arena = true;
+    std::string content = "User-agent: one\nDisallow: /one\n";
+    Rep::Robots robot(content, "", options);
+    Rep::Robots moved("User-agent: two\nDisallow: /two\n", "", options);
+    moved = Rep::Robots(content, "", options);
+    EXPECT_FALSE(moved.allowed("/one", "one"));
+    EXPECT_TRUE(moved.allowed("/two", "two"));
+
+    Rep::Robots copied("User-agent: two\nDisallow: /two\n", "", options);
+    copied = robot;
+    EXPECT_FALSE(copied.allowed("/one", "one"));
+    EXPECT_EQ(robot.str(), copied.str());
+}
+
+TEST(RobotsTest, LazyMatchesEager)
+{
+    std::vector<std::string> contents = {
+        "User-agent: unhipbot\n"
+        "Disallow: /\n"
+        "\n"
+        "User-agent: webcrawler\n"
+        "User-agent: excite\n"
+        "Disallow:\n"
+        "\n"
+        "User-agent: *\n"
+        "Disallow: /org/plans.html\n"
+        "Allow: /org/\n"
+        "Allow: /serv\n"
+        "Allow: /~mak\n"
+        "Disallow: /\n",
+        // Rules before any agent, comments, sitemaps and unknown keys between rules
+        "Disallow: /a # comment\n"
+        "User-agent: one\n"
+        "User-agent: two\n"
+        "Disallow: /b\n"
+        "Sitemap: http://a.com/sitemap.xml\n"
+        "Crawl-delay: 5\n"
+        "Unknown: value\n"
+        "Allow: /b/c\n"
+        // A name reopened after sharing its group's rules
+        "User-agent: one\n"
+        "Disallow: /d\n"
+        "User-agent: *\n"
+        "Disallow: /e\n"
+    };
+    std::vector<std::string> names = {"unhipbot", "excite", "one", "two", "other"};
+    std::vector<std::string> paths = {"/", "/a", "/b", "/b/c", "/d", "/e", "/org/"};
+    Rep::Robots::Options options;
+    options.lazy = true;
+    for (const auto& content : contents)
+    {
+        Rep::Robots eager(content);
+        Rep::Robots lazy(content, "", options);
+        EXPECT_EQ(eager.sitemaps(), lazy.sitemaps());
+        for (const auto& name : names)
+        {
+            EXPECT_EQ(eager.agent(name).delay(), lazy.agent(name).delay());
+            for (const auto& path : paths)
+            {
+                EXPECT_EQ(eager.allowed(path, name), lazy.allowed(path, name))
+                    << name << " " << path;
+            }
+        }
+        EXPECT_EQ(eager.str(), Rep::Robots(content, "", options).str());
+        EXPECT_EQ(eager.serialize(), Rep::Robots(content, "", options).serialize());
+        EXPECT_EQ(eager.str(), Rep::Robots(Rep::Robots(content, "", options)).str());
+    }
+}
+
+TEST(RobotsTest, LazyOptions)
+{
+    std::string content =
+        "User-agent: one\n"
+        "Disallow: /a\n"
+        "Disallow: /a/b\n"
+        "User-agent: two\n"
+        "Disallow: /a\n";
+    Rep::RulePool pool;
+    Rep::Robots::Options options;
+    options.lazy = true;
+    options.pool = &pool;
+    options.stats = true;
+    options.arena = true;
+    options.minimize = true;
+    Rep::Robots robot(content, "", options);
+    size_t usage = robot.memory_usage();
+    EXPECT_LT(content.size(), usage);
+
+    // Agents are only finished once parsed, and are minimized before being interned
+    EXPECT_EQ(0ul, pool.size());
+    EXPECT_FALSE(robot.allowed("/a", "one"));
+    EXPECT_EQ(1ul, pool.size());
+    EXPECT_FALSE(robot.allowed("/a", "two"));
+    EXPECT_EQ(&robot.agent("one").directives(), &robot.agent("two").directives());
+}
+
+TEST(RobotsTest, LazyRuleThrows)
+{
+    std::string content =
+        "User-agent: *\n"
+        "Disallow: /a\n"
+        "Disallow: http://x.com:ab/\n";
+    Rep::Robots::Options options;
+    options.lazy = true;
+    Rep::Robots robot(content, "", options);
+
+    // A partly parsed agent is never published, so every lookup throws alike
+    EXPECT_THROW(robot.agent("*"), Url::UrlParseException);
+    EXPECT_THROW(robot.agent("*"), Url::UrlParseException);
+    EXPECT_THROW(robot.allowed("/a", "agent"), Url::UrlParseException);
+}
+
+TEST(RobotsTest, LazyConcurrentLookups)
+{
+    std::string content;
+    for (size_t agent = 0; agent < 20; ++agent)
+    {
+        content += "User-agent: agent-" + std::to_string(agent) + "\n";
+        for (size_t rule = 0; rule < 20; ++rule)
+        {
+            content += "Disallow: /" + std::to_string(rule) + "/\n";
+        }
+    }
+    Rep::Robots::Options options;
+    options.lazy = true;
+    options.arena = true;
+    Rep::Robots robot(content, "", options);
+
+    // Many threads parse agents' rules on first use at once
+    std::vector<std::thread> threads;
+    std::vector<size_t> disallowed(8, 0);
+    for (size_t thread = 0; thread < disallowed.size(); ++thread)
+    {
+        threads.emplace_back([&robot, &disallowed, thread]() {
+            for (size_t agent = 0; agent < 20; ++agent)
+            {
+                std::string name = "agent-" + std::to_string((agent + thread) % 20);
+                disallowed[thread] += !robot.allowed("/5/page", name);
+                disallowed[thread] += robot.agent(name).directives().size();
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    for (size_t count : disallowed)
+    {
+        EXPECT_EQ(20ul * 21, count);
+    }
+}
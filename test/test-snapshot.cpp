@@ -0,0 +1,186 @@
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <gtest/gtest.h>
+
+#include "robots.h"
+#include "snapshot.h"
+
+namespace
+{
+    const std::string content =
+        "User-agent: unhipbot\n"
+        "Disallow: /\n"
+        "\n"
+        "User-agent: webcrawler\n"
+        "User-agent: excite\n"
+        "Disallow:\n"
+        "Crawl-delay: 2.5\n"
+        "\n"
+        "User-agent: *\n"
+        "Disallow: /org/plans.html\n"
+        "Allow: /org/\n"
+        "Allow: /serv\n"
+        "Allow: /~mak\n"
+        "Allow: /*.gif$\n"
+        "Disallow: /\n"
+        "Disallow: /tie\n"
+        "Allow: /tie\n"
+        "\n"
+        "Sitemap: http://a.com/sitemap.xml\n"
+        "Sitemap: http://a.com/other.xml\n";
+
+    const std::vector<std::string> paths = {
+        "/", "/index.html", "/robots.txt", "/server.html", "/services/fast.html",
+        "/orgo.gif", "/org/about.html", "/org/plans.html", "/%7Ejim/jim.html",
+        "/%7Emak/mak.html", "/tie", "http://a.com/org/", "http://b.com/org/"
+    };
+
+    const std::vector<std::string> agents = {
+        "unhipbot", "WebCrawler", "excite", "anything", "", "zzz"
+    };
+
+    size_t word(const std::string& data, size_t offset)
+    {
+        size_t result = 0;
+        for (size_t index = 4; index > 0; --index)
+        {
+            result = (result << 8) | static_cast<unsigned char>(data[offset + index - 1]);
+        }
+        return result;
+    }
+}
+
+TEST(SnapshotTest, MatchesRobots)
+{
+    Rep::Robots robot(content, "http://a.com/robots.txt");
+    std::string serialized = robot.serialize();
+    Rep::Snapshot snapshot(serialized.data(), serialized.size());
+    EXPECT_EQ(serialized.size(), snapshot.size());
+
+    // The names in a group share their agent's directives
+    EXPECT_EQ(10ul, word(serialized, 32));
+    for (const auto& agent : agents)
+    {
+        for (const auto& path : paths)
+        {
+            EXPECT_EQ(robot.allowed(path, agent), snapshot.allowed(path, agent))
+                << agent << " " << path;
+        }
+        EXPECT_EQ(robot.agent(agent).delay(), snapshot.delay(agent)) << agent;
+    }
+    EXPECT_EQ(robot.sitemaps(), snapshot.sitemaps());
+}
+
+TEST(SnapshotTest, Concatenated)
+{
+    std::string first = Rep::Robots("Disallow: /", "").serialize();
+    std::string second = Rep::Robots("Disallow: /second", "").serialize();
+    std::string both = first + second;
+    Rep::Snapshot snapshot(both.data(), both.size());
+    EXPECT_EQ(first.size(), snapshot.size());
+    EXPECT_FALSE(snapshot.allowed("/second", "agent"));
+
+    Rep::Snapshot next(both.data() + snapshot.size(), both.size() - snapshot.size());
+    EXPECT_TRUE(next.allowed("/first", "agent"));
+    EXPECT_FALSE(next.allowed("/second", "agent"));
+}
+
+TEST(SnapshotTest, NamesBeforeDefault)
+{
+    // Names may sort before "*", which is then not the first agent
+    std::string serialized = Rep::Robots(
+        "User-agent: (bot)\nDisallow: /a\nUser-agent: *\nDisallow: /b\n", "").serialize();
+    Rep::Snapshot snapshot(serialized.data(), serialized.size());
+    EXPECT_FALSE(snapshot.allowed("/a", "(bot)"));
+    EXPECT_TRUE(snapshot.allowed("/b", "(bot)"));
+    EXPECT_FALSE(snapshot.allowed("/b", "other"));
+}
+
+TEST(SnapshotTest, TiesWithOtherRules)
+{
+    // Only an allow of the same priority that also matches wins the tie
+    std::string serialized = Rep::Robots(
+        "User-agent: *\nDisallow: /tie\nAllow: /tix\nAllow: /ti\n", "").serialize();
+    Rep::Snapshot snapshot(serialized.data(), serialized.size());
+    EXPECT_FALSE(snapshot.allowed("/tie", "agent"));
+    EXPECT_TRUE(snapshot.allowed("/tix", "agent"));
+}
+
+TEST(SnapshotTest, Invalid)
+{
+    std::string serialized = Rep::Robots(content, "http://a.com/").serialize();
+    auto invalid = [](const std::string& data) {
+        return Rep::Snapshot(data.data(), data.size());
+    };
+    EXPECT_THROW(invalid("REPS"), std::invalid_argument);
+    EXPECT_THROW(invalid("X" + serialized.substr(1)), std::invalid_argument);
+    EXPECT_THROW(invalid(serialized.substr(0, serialized.size() - 1)),
+                 std::invalid_argument);
+
+    std::string version(serialized);
+    version[4] = 2;
+    EXPECT_THROW(invalid(version), std::invalid_argument);
+
+    std::string host(serialized);
+    host[15] = 0x7F;
+    EXPECT_THROW(invalid(host), std::invalid_argument);
+
+    std::string default_agent(serialized);
+    default_agent[20] = 100;
+    EXPECT_THROW(invalid(default_agent), std::invalid_argument);
+
+    // The first agent claims more directives than there are
+    std::string directives(serialized);
+    directives[Rep::Snapshot::header_size + 12] = 100;
+    EXPECT_THROW(invalid(directives), std::invalid_argument);
+
+    // The first directive's expression runs off the end
+    std::string expression(serialized);
+    expression[word(serialized, 36) + 7] = 1;
+    EXPECT_THROW(invalid(expression), std::invalid_argument);
+
+    // The last sitemap's string runs off the end
+    std::string sitemap(serialized);
+    sitemap[word(serialized, 44) + Rep::Snapshot::sitemap_size + 7] = 1;
+    EXPECT_THROW(invalid(sitemap), std::invalid_argument);
+}
+
+TEST(SnapshotTest, MappedFile)
+{
+    std::string path("test-snapshot.bin");
+    std::string serialized = Rep::Robots(content, "http://a.com/").serialize();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << serialized;
+    }
+    {
+        Rep::MappedFile file(path);
+        EXPECT_EQ(serialized.size(), file.size());
+        Rep::Snapshot snapshot(file.data(), file.size());
+        EXPECT_FALSE(snapshot.allowed("/", "unhipbot"));
+        EXPECT_TRUE(snapshot.allowed("/", "excite"));
+    }
+    std::remove(path.c_str());
+}
+
+TEST(SnapshotTest, MappedEmptyFile)
+{
+    std::string path("test-snapshot-empty.bin");
+    {
+        std::ofstream out(path, std::ios::binary);
+    }
+    {
+        Rep::MappedFile file(path);
+        EXPECT_EQ(0ul, file.size());
+        EXPECT_EQ(nullptr, file.data());
+    }
+    std::remove(path.c_str());
+}
+
+TEST(SnapshotTest, MappedFileMissing)
+{
+    EXPECT_THROW(Rep::MappedFile("does/not/exist"), std::system_error);
+}
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "robots.h"
+#include "stats.h"
+
+namespace
+{
+    typedef Rep::Stats::Outcome Outcome;
+    typedef std::chrono::nanoseconds nanoseconds;
+}
+
+TEST(StatsTest, Counters)
+{
+    Rep::Stats stats(2);
+    stats.record(Outcome::allowed, 0, nanoseconds(10));
+    stats.record(Outcome::disallowed, 1, nanoseconds(10));
+    stats.record(Outcome::disallowed, 1, nanoseconds(10));
+    stats.record(Outcome::fallback, 5, nanoseconds(10));
+    stats.record(Outcome::robots, 0, nanoseconds(10));
+    EXPECT_EQ(5ul, stats.checks());
+    EXPECT_EQ(3ul, stats.allows());
+    EXPECT_EQ(2ul, stats.disallows());
+    EXPECT_EQ(1ul, stats.fallbacks());
+    EXPECT_EQ(1ul, stats.robots());
+
+    // Only the directives that decided a check are hit
+    EXPECT_EQ(2ul, stats.directives());
+    EXPECT_EQ(1ul, stats.hits(0));
+    EXPECT_EQ(2ul, stats.hits(1));
+    EXPECT_EQ(0ul, stats.hits(2));
+}
+
+TEST(StatsTest, Latency)
+{
+    Rep::Stats stats(0);
+    EXPECT_EQ(0ul, stats.percentile(0.5));
+
+    stats.record(Outcome::fallback, 0, nanoseconds(0));
+    stats.record(Outcome::fallback, 0, nanoseconds(1));
+    stats.record(Outcome::fallback, 0, nanoseconds(100));
+    stats.record(Outcome::fallback, 0, nanoseconds(127));
+    stats.record(Outcome::fallback, 0, std::chrono::hours(1));
+    EXPECT_EQ(2ul, stats.latency(0));
+    EXPECT_EQ(2ul, stats.latency(6));
+    EXPECT_EQ(1ul, stats.latency(Rep::Stats::buckets - 1));
+    EXPECT_EQ(0ul, stats.latency(Rep::Stats::buckets));
+
+    EXPECT_EQ(1ul, stats.percentile(0));
+    EXPECT_EQ(1ul, stats.percentile(0.4));
+    EXPECT_EQ(127ul, stats.percentile(0.8));
+    EXPECT_EQ((1ul << Rep::Stats::buckets) - 1, stats.percentile(1));
+}
+
+TEST(StatsTest, ConcurrentRecords)
+{
+    Rep::Stats stats(1);
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < 4; ++thread)
+    {
+        threads.emplace_back([&stats]() {
+            for (size_t index = 0; index < 10000; ++index)
+            {
+                stats.record(Outcome::allowed, 0, nanoseconds(index));
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(40000ul, stats.checks());
+    EXPECT_EQ(40000ul, stats.hits(0));
+}
+
+#ifdef REP_STATS
+
+TEST(StatsTest, Agent)
+{
+    Rep::Agent agent = Rep::Agent("a.com").disallow("/a").allow("/a/b");
+    agent.instrument();
+    ASSERT_NE(nullptr, agent.stats());
+    EXPECT_FALSE(agent.allowed("/a"));
+    EXPECT_TRUE(agent.allowed("/a/b"));
+    EXPECT_TRUE(agent.allowed_path("/other"));
+    EXPECT_TRUE(agent.allowed("/robots.txt"));
+
+    const Rep::Stats& stats = *agent.stats();
+    EXPECT_EQ(4ul, stats.checks());
+    EXPECT_EQ(1ul, stats.disallows());
+    EXPECT_EQ(1ul, stats.fallbacks());
+    EXPECT_EQ(1ul, stats.robots());
+    EXPECT_EQ(1ul, stats.hits(0));
+    EXPECT_EQ(1ul, stats.hits(1));
+
+    // Compiled agents record the same outcomes
+    agent.compile();
+    EXPECT_FALSE(agent.allowed("/a/c"));
+    EXPECT_EQ(2ul, stats.hits(1));
+
+    // Adding a directive discards the stats
+    agent.allow("/c");
+    EXPECT_EQ(nullptr, agent.stats());
+}
+
+TEST(StatsTest, Robots)
+{
+    Rep::Robots::Options options;
+    options.stats = true;
+    Rep::Robots robot("User-agent: *\nDisallow: /a\n", "", options);
+    EXPECT_FALSE(robot.allowed("/a", "agent"));
+    ASSERT_NE(nullptr, robot.agent("agent").stats());
+    EXPECT_EQ(1ul, robot.agent("agent").stats()->disallows());
+}
+
+#else
+
+TEST(StatsTest, CompiledOut)
+{
+    Rep::Agent agent = Rep::Agent("a.com").disallow("/a");
+    agent.instrument();
+    EXPECT_EQ(nullptr, agent.stats());
+
+    Rep::Robots::Options options;
+    options.stats = true;
+    Rep::Robots robot("User-agent: *\nDisallow: /a\n", "", options);
+    EXPECT_EQ(nullptr, robot.agent("agent").stats());
+}
+
+#endif